@@ -73,10 +73,208 @@ namespace {
 
 	Histories histories;
 
-	typedef QHash<MsgId, HistoryItem*> MsgsData;
+	// All the registered messages from all the channels and the common box,
+	// open addressing with linear probing and backward shift deletion.
+	class MsgsData {
+	public:
+		HistoryItem *find(ChannelId channelId, MsgId msgId) const {
+			if (_slots.empty()) return nullptr;
+
+			auto key = composeKey(channelId, msgId);
+			for (auto i = slotIndex(key); ; i = nextIndex(i)) {
+				auto &slot = _slots[i];
+				if (!slot.item) {
+					return nullptr;
+				} else if (slot.key == key) {
+					return slot.item;
+				}
+			}
+		}
+
+		// Returns the item previously registered with the same id.
+		HistoryItem *insert(HistoryItem *item) {
+			reserve(_count + 1);
+
+			auto key = composeKey(item->channelId(), item->id);
+			for (auto i = slotIndex(key); ; i = nextIndex(i)) {
+				auto &slot = _slots[i];
+				if (!slot.item) {
+					slot.key = key;
+					slot.item = item;
+					++_count;
+					return nullptr;
+				} else if (slot.key == key) {
+					auto result = slot.item;
+					slot.item = item;
+					return result;
+				}
+			}
+		}
+
+		// Removes the item only if it is the one registered with its id.
+		void remove(HistoryItem *item) {
+			if (_slots.empty()) return;
+
+			auto key = composeKey(item->channelId(), item->id);
+			auto i = slotIndex(key);
+			for (; _slots[i].item; i = nextIndex(i)) {
+				if (_slots[i].key == key) break;
+			}
+			if (_slots[i].item != item) return;
+
+			// Move back the following items of this probe sequence to fill the hole.
+			for (auto j = nextIndex(i); _slots[j].item; j = nextIndex(j)) {
+				auto ideal = slotIndex(_slots[j].key);
+				auto stays = (i <= j) ? (i < ideal && ideal <= j) : (i < ideal || ideal <= j);
+				if (!stays) {
+					_slots[i] = _slots[j];
+					i = j;
+				}
+			}
+			_slots[i].item = nullptr;
+			--_count;
+		}
+
+		void reserve(int count) {
+			auto capacity = _slots.size();
+			if (size_t(count) * 2 <= capacity) return;
+
+			if (capacity < MinCapacity) capacity = MinCapacity;
+			while (size_t(count) * 2 > capacity) capacity *= 2;
+
+			std::vector<Slot> old(capacity);
+			std::swap(old, _slots);
+			for_const (auto &slot, old) {
+				if (slot.item) {
+					auto i = slotIndex(slot.key);
+					while (_slots[i].item) i = nextIndex(i);
+					_slots[i] = slot;
+				}
+			}
+		}
+		int size() const {
+			return _count;
+		}
+
+		template <typename Callback>
+		void enumerate(Callback callback) const {
+			for_const (auto &slot, _slots) {
+				if (slot.item) {
+					callback(slot.item);
+				}
+			}
+		}
+		void clear() {
+			std::vector<Slot>().swap(_slots);
+			_count = 0;
+		}
+
+	private:
+		enum {
+			MinCapacity = 1024,
+		};
+		struct Slot {
+			uint64 key = 0;
+			HistoryItem *item = nullptr;
+		};
+
+		static uint64 composeKey(ChannelId channelId, MsgId msgId) {
+			return (uint64(uint32(channelId)) << 32) | uint64(uint32(msgId));
+		}
+		size_t slotIndex(uint64 key) const {
+			// 64 bit finalizer from MurmurHash3, message ids are sequential.
+			key ^= key >> 33;
+			key *= 0xff51afd7ed558ccdULL;
+			key ^= key >> 33;
+			key *= 0xc4ceb9fe1a85ec53ULL;
+			key ^= key >> 33;
+			return size_t(key) & (_slots.size() - 1);
+		}
+		size_t nextIndex(size_t index) const {
+			return (index + 1) & (_slots.size() - 1);
+		}
+
+		std::vector<Slot> _slots;
+		int _count = 0;
+
+	};
 	MsgsData msgsData;
-	typedef QMap<ChannelId, MsgsData> ChannelMsgsData;
-	ChannelMsgsData channelMsgsData;
+
+	// Inverted index of the text words of all registered messages,
+	// searched by word prefixes for the local messages search.
+	// It is built on the first search, until then add() and remove() do nothing.
+	// It is not saved: the local hits are only shown until the server results
+	// arrive, and the only messages on disk are the newest cached pages, which
+	// the server search returns as well. A page from the local history cache
+	// is indexed when it is read to be shown.
+	class MsgsTextIndex {
+	public:
+		bool built() const {
+			return _built;
+		}
+		void build(const MsgsData &data) {
+			_built = true;
+			data.enumerate([this](HistoryItem *item) {
+				add(item);
+			});
+		}
+		void add(HistoryItem *item) {
+			if (!_built) return;
+
+			auto words = textSearchKey(item->originalText().text).split(cWordSplit(), QString::SkipEmptyParts);
+			if (words.isEmpty()) return;
+
+			words.removeDuplicates();
+			for_const (auto &word, words) {
+				_items[word].insert(item);
+			}
+			_words.insert(item, words);
+		}
+		void remove(HistoryItem *item) {
+			auto i = _words.find(item);
+			if (i == _words.cend()) return;
+
+			for_const (auto &word, i.value()) {
+				auto j = _items.find(word);
+				if (j != _items.cend()) {
+					j.value().remove(item);
+					if (j.value().isEmpty()) {
+						_items.erase(j);
+					}
+				}
+			}
+			_words.erase(i);
+		}
+		QSet<HistoryItem*> find(const QStringList &words) const {
+			QSet<HistoryItem*> result;
+			for (int i = 0, l = words.size(); i != l; ++i) {
+				QSet<HistoryItem*> byWord;
+				const auto &word(words.at(i));
+				for (auto j = _items.lowerBound(word), e = _items.cend(); j != e && j.key().startsWith(word); ++j) {
+					byWord.unite(j.value());
+				}
+				if (i) {
+					result.intersect(byWord);
+				} else {
+					result = byWord;
+				}
+				if (result.isEmpty()) break;
+			}
+			return result;
+		}
+		void clear() {
+			_items.clear();
+			_words.clear();
+			_built = false;
+		}
+
+	private:
+		bool _built = false;
+		QMap<QString, QSet<HistoryItem*>> _items;
+		QHash<HistoryItem*, QStringList> _words;
+
+	};
+	MsgsTextIndex msgsTextIndex;
 
 	typedef QMap<uint64, FullMsgId> RandomData;
 	RandomData randomData;
@@ -777,6 +975,38 @@ namespace {
 		return result;
 	}
 
+	void feedCachedUsers(const MTPVector<MTPUser> &users) {
+		QVector<MTPUser> notLoaded;
+		for_const (auto &user, users.c_vector().v) {
+			auto userId = (user.type() == mtpc_user) ? user.c_user().vid.v : user.c_userEmpty().vid.v;
+			if (!peer(peerFromUser(userId), PeerData::MinimalLoaded)) {
+				notLoaded.push_back(user);
+			}
+		}
+		if (!notLoaded.isEmpty()) {
+			feedUsers(MTP_vector<MTPUser>(notLoaded));
+		}
+	}
+
+	void feedCachedChats(const MTPVector<MTPChat> &chats) {
+		QVector<MTPChat> notLoaded;
+		for_const (auto &chat, chats.c_vector().v) {
+			PeerId id = 0;
+			switch (chat.type()) {
+			case mtpc_chat: id = peerFromChat(chat.c_chat().vid.v); break;
+			case mtpc_chatForbidden: id = peerFromChat(chat.c_chatForbidden().vid.v); break;
+			case mtpc_channel: id = peerFromChannel(chat.c_channel().vid.v); break;
+			case mtpc_channelForbidden: id = peerFromChannel(chat.c_channelForbidden().vid.v); break;
+			}
+			if (id && !peer(id, PeerData::MinimalLoaded)) {
+				notLoaded.push_back(chat);
+			}
+		}
+		if (!notLoaded.isEmpty()) {
+			feedChats(MTP_vector<MTPChat>(notLoaded));
+		}
+	}
+
 	void feedParticipants(const MTPChatParticipants &p, bool requestBotInfos, bool emitPeerUpdated) {
 		ChatData *chat = 0;
 		switch (p.type()) {
@@ -1139,6 +1369,7 @@ namespace {
 	}
 
 	void feedMsgs(const QVector<MTPMessage> &msgs, NewMessageType type) {
+		TRACE_SCOPE("App::feedMsgs");
 		QMap<uint64, int32> msgsIds;
 		for (int32 i = 0, l = msgs.size(); i < l; ++i) {
 			const auto &msg(msgs.at(i));
@@ -1237,31 +1468,14 @@ namespace {
 		}
 	}
 
-	inline MsgsData *fetchMsgsData(ChannelId channelId, bool insert = true) {
-		if (channelId == NoChannel) return &msgsData;
-		ChannelMsgsData::iterator i = channelMsgsData.find(channelId);
-		if (i == channelMsgsData.cend()) {
-			if (insert) {
-				i = channelMsgsData.insert(channelId, MsgsData());
-			} else {
-				return 0;
-			}
-		}
-		return &(*i);
-	}
-
 	void feedWereDeleted(ChannelId channelId, const QVector<MTPint> &msgsIds) {
-		MsgsData *data = fetchMsgsData(channelId, false);
-		if (!data) return;
-
 		ChannelHistory *channelHistory = (channelId == NoChannel) ? 0 : App::historyLoaded(peerFromChannel(channelId))->asChannelHistory();
 
 		QMap<History*, bool> historiesToCheck;
 		for (QVector<MTPint>::const_iterator i = msgsIds.cbegin(), e = msgsIds.cend(); i != e; ++i) {
-			MsgsData::const_iterator j = data->constFind(i->v);
-			if (j != data->cend()) {
-				History *h = (*j)->history();
-				(*j)->destroy();
+			if (auto item = msgsData.find(channelId, i->v)) {
+				History *h = item->history();
+				item->destroy();
 				if (!h->lastMsg) historiesToCheck.insert(h, true);
 			} else {
 				if (channelHistory) {
@@ -1841,26 +2055,53 @@ namespace {
 	HistoryItem *histItemById(ChannelId channelId, MsgId itemId) {
 		if (!itemId) return nullptr;
 
-		MsgsData *data = fetchMsgsData(channelId, false);
-		if (!data) return nullptr;
-
-		auto i = data->constFind(itemId);
-		if (i != data->cend()) {
-			return i.value();
-		}
-		return nullptr;
+		return msgsData.find(channelId, itemId);
 	}
 
 	void historyRegItem(HistoryItem *item) {
-		MsgsData *data = fetchMsgsData(item->channelId());
-		MsgsData::const_iterator i = data->constFind(item->id);
-		if (i == data->cend()) {
-			data->insert(item->id, item);
-		} else if (i.value() != item) {
+		auto already = msgsData.find(item->channelId(), item->id);
+		if (!already) {
+			msgsData.insert(item);
+			msgsTextIndex.add(item);
+		} else if (already != item) {
 			LOG(("App Error: trying to historyRegItem() an already registered item"));
-			i.value()->destroy();
-			data->insert(item->id, item);
+			already->destroy();
+			msgsData.insert(item);
+			msgsTextIndex.add(item);
+		}
+	}
+
+	void historyReindexItemText(HistoryItem *item) {
+		msgsTextIndex.remove(item);
+		if (msgsData.find(item->channelId(), item->id) == item) {
+			msgsTextIndex.add(item);
+		}
+	}
+
+	QVector<HistoryItem*> historySearchLoaded(const QString &query, PeerData *inPeer, PeerData *inMigrated, int limit) {
+		QVector<HistoryItem*> result;
+		auto words = textSearchKey(query).split(cWordSplit(), QString::SkipEmptyParts);
+		if (words.isEmpty()) return result;
+
+		if (!msgsTextIndex.built()) {
+			msgsTextIndex.build(msgsData);
 		}
+		for_const (auto item, msgsTextIndex.find(words)) {
+			if (item->id <= 0) continue;
+			if (inPeer && item->history()->peer != inPeer && item->history()->peer != inMigrated) continue;
+			result.push_back(item);
+		}
+		std::sort(result.begin(), result.end(), [](HistoryItem *a, HistoryItem *b) {
+			return (a->date > b->date) || (a->date == b->date && a->id > b->id);
+		});
+		if (result.size() > limit) {
+			result.resize(limit);
+		}
+		return result;
+	}
+
+	void historyReserveItems(int count) {
+		msgsData.reserve(msgsData.size() + count);
 	}
 
 	void historyItemDetached(HistoryItem *item) {
@@ -1888,15 +2129,8 @@ namespace {
 	}
 
 	void historyUnregItem(HistoryItem *item) {
-		MsgsData *data = fetchMsgsData(item->channelId(), false);
-		if (!data) return;
-
-		auto i = data->find(item->id);
-		if (i != data->cend()) {
-			if (i.value() == item) {
-				data->erase(i);
-			}
-		}
+		msgsData.remove(item);
+		msgsTextIndex.remove(item);
 		historyItemDetached(item);
 		auto j = ::dependentItems.find(item);
 		if (j != ::dependentItems.cend()) {
@@ -1929,20 +2163,13 @@ namespace {
 		::dependentItems.clear();
 
 		QVector<HistoryItem*> toDelete;
-		for_const (HistoryItem *item, msgsData) {
+		msgsData.enumerate([&toDelete](HistoryItem *item) {
 			if (item->detached()) {
 				toDelete.push_back(item);
 			}
-		}
-		for_const (const MsgsData &chMsgsData, channelMsgsData) {
-			for_const (HistoryItem *item, chMsgsData) {
-				if (item->detached()) {
-					toDelete.push_back(item);
-				}
-			}
-		}
+		});
 		msgsData.clear();
-		channelMsgsData.clear();
+		msgsTextIndex.clear();
 		for (int32 i = 0, l = toDelete.size(); i < l; ++i) {
 			delete toDelete[i];
 		}
@@ -2010,6 +2237,10 @@ namespace {
 		}
 	}
 
+	bool historyHasDependentItems(const HistoryItem *dependency) {
+		return ::dependentItems.contains(const_cast<HistoryItem*>(dependency));
+	}
+
 	void historyRegRandom(uint64 randomId, const FullMsgId &itemId) {
 		randomData.insert(randomId, itemId);
 	}
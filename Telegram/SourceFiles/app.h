@@ -68,6 +68,11 @@ namespace App {
 	UserData *feedUsers(const MTPVector<MTPUser> &users); // returns last user
 	PeerData *feedChats(const MTPVector<MTPChat> &chats); // returns last chat
 
+	// Feed users and chats from a local cache, the already loaded ones are
+	// skipped so that outdated cached data never replaces the actual one.
+	void feedCachedUsers(const MTPVector<MTPUser> &users);
+	void feedCachedChats(const MTPVector<MTPChat> &chats);
+
 	void feedParticipants(const MTPChatParticipants &p, bool requestBotInfos, bool emitPeerUpdated = true);
 	void feedParticipantAdd(const MTPDupdateChatParticipantAdd &d, bool emitPeerUpdated = true);
 	void feedParticipantDelete(const MTPDupdateChatParticipantDelete &d, bool emitPeerUpdated = true);
@@ -176,13 +181,19 @@ namespace App {
 		return histItemById(msgId.channel, msgId.msg);
 	}
 	void historyRegItem(HistoryItem *item);
+	void historyReserveItems(int count);
 	void historyItemDetached(HistoryItem *item);
 	void historyUnregItem(HistoryItem *item);
+	void historyReindexItemText(HistoryItem *item);
+
+	// Newest loaded messages containing all query words, for the local messages search.
+	QVector<HistoryItem*> historySearchLoaded(const QString &query, PeerData *inPeer, PeerData *inMigrated, int limit);
 	void historyUpdateDependent(HistoryItem *item);
 	void historyClearMsgs();
 	void historyClearItems();
 	void historyRegDependency(HistoryItem *dependent, HistoryItem *dependency);
 	void historyUnregDependency(HistoryItem *dependent, HistoryItem *dependency);
+	bool historyHasDependentItems(const HistoryItem *dependency);
 
 	void historyRegRandom(uint64 randomId, const FullMsgId &itemId);
 	void historyUnregRandom(uint64 randomId);
@@ -307,8 +307,9 @@ void ContactsInner::loadProfilePhotos(int32 yFrom) {
 	if (_filter.isEmpty()) {
 		if (!_contacts->isEmpty()) {
 			auto i = _contacts->cfind(yFrom - _newItemHeight, _rowHeight);
-			for (auto end = _contacts->cend(); i != end; ++i) {
-				if ((_newItemHeight + (*i)->pos() * _rowHeight) >= yTo) {
+			int32 y = _newItemHeight + (*i)->pos() * _rowHeight;
+			for (auto end = _contacts->cend(); i != end; ++i, y += _rowHeight) {
+				if (y >= yTo) {
 					break;
 				}
 				(*i)->history()->peer->loadUserpic();
@@ -479,9 +480,10 @@ void ContactsInner::paintEvent(QPaintEvent *e) {
 			}
 			if (!_contacts->isEmpty()) {
 				auto i = _contacts->cfind(yFrom, _rowHeight);
-				p.translate(0, (*i)->pos() * _rowHeight);
-				for (auto end = _contacts->cend(); i != end; ++i) {
-					if ((*i)->pos() * _rowHeight >= yTo) {
+				int32 y = (*i)->pos() * _rowHeight;
+				p.translate(0, y);
+				for (auto end = _contacts->cend(); i != end; ++i, y += _rowHeight) {
+					if (y >= yTo) {
 						break;
 					}
 					paintDialog(p, (*i)->history()->peer, contactData(*i), (*i == _sel));
@@ -826,40 +828,9 @@ void ContactsInner::updateFilter(QString filter) {
 
 			_filtered.clear();
 			if (!f.isEmpty()) {
-				const Dialogs::List *toFilter = nullptr;
-				if (!_contacts->isEmpty()) {
-					for (fi = fb; fi != fe; ++fi) {
-						auto found = _contacts->filtered(fi->at(0));
-						if (found->isEmpty()) {
-							toFilter = nullptr;
-							break;
-						}
-						if (!toFilter || toFilter->size() > found->size()) {
-							toFilter = found;
-						}
-					}
-				}
-				if (toFilter) {
-					_filtered.reserve(toFilter->size());
-					for_const (auto row, *toFilter) {
-						const PeerData::Names &names(row->history()->peer->names);
-						PeerData::Names::const_iterator nb = names.cbegin(), ne = names.cend(), ni;
-						for (fi = fb; fi != fe; ++fi) {
-							QString filterName(*fi);
-							for (ni = nb; ni != ne; ++ni) {
-								if (ni->startsWith(*fi)) {
-									break;
-								}
-							}
-							if (ni == ne) {
-								break;
-							}
-						}
-						if (fi == fe) {
-							row->attached = nullptr;
-							_filtered.push_back(row);
-						}
-					}
+				_filtered = _contacts->filtered(f);
+				for_const (auto row, _filtered) {
+					row->attached = nullptr;
 				}
 
 				_byUsernameFiltered.reserve(_byUsername.size());
@@ -82,6 +82,14 @@ enum {
 	ClipThreadsCount = 8,
 	AverageGifSize = 320 * 240,
 	WaitBeforeGifPause = 200, // wait 200ms for gif draw before pausing it
+	ClipThreadBusyLevel = 600, // clip thread spending 60% of time in decoding gives readers to less busy threads
+	ClipThreadBalanceTimeout = 500, // move at most one reader from a clip thread in 500ms
+	ClipSuspendTimeout = 3000, // release the decoder of a gif paused for 3s, it will be restarted from a keyframe
+	ClipDecodeBudgetPerCore = 500, // playing gifs may spend 50% of each core in decoding before slowing down
+	ClipActiveReadersLimit = 16, // more gifs playing at the same time are slowed down
+	ClipMaxFrameDelaySlowdown = 400, // gifs are played at least at 25% of their frame rate
+	ClipFramesCacheClipLimit = 4 * 1024 * 1024, // gifs with all the frames in 4 Mb loop without decoding
+	ClipFramesCacheLimit = 32 * 1024 * 1024, // 32 Mb of decoded frames held for all the looping gifs
 	InlineBotRequestDelay = 400, // wait 400ms before context bot realtime request
 	RecentInlineBotsLimit = 10,
 
@@ -131,6 +139,7 @@ enum {
 	ShortcutsCountLimit = 256, // how many shortcuts can be in json file
 
 	PreloadHeightsCount = 3, // when 3 screens to scroll left make a preload request
+	UnloadHeightsCount = 12, // history blocks more than 12 screens away from the visible area are unloaded
 	EmojiPanPerRow = 7,
 	EmojiPanRowsPerPage = 6,
 	StickerPanPerRow = 5,
@@ -138,6 +147,7 @@ enum {
 	StickersUpdateTimeout = 3600000, // update not more than once in an hour
 
 	SearchPeopleLimit = 5,
+	FilterTypoMinLength = 3, // match names with one typo only for filter words of 3+ letters
 	MinUsernameLength = 5,
 	MaxUsernameLength = 32,
 	UsernameCheckTimeout = 200,
@@ -337,9 +347,12 @@ enum {
 
 	DialogsFirstLoad = 20, // first dialogs part size requested
 	DialogsPerPage = 500, // next dialogs part size
+	DialogsCacheLimit = 2000, // max dialogs count saved to the local dialogs cache
+	DialogsRowCachesCount = 48, // keep painted rasters of last 48 painted dialogs rows
 
 	MessagesFirstLoad = 30, // first history part size requested
 	MessagesPerPage = 50, // next history part size
+	HistoryCacheLimit = 64, // first pages of that many recently opened chats are kept on disk
 
 	FileLoaderQueueStopTimeout = 5000,
 
@@ -366,6 +379,9 @@ enum {
 	NoUpdatesAfterSleepTimeout = 60 * 1000, // if nothing is received in 1 min when was a sleepmode we ping
 	WaitForSkippedTimeout = 1000, // 1s wait for skipped seq or pts in updates
 	WaitForChannelGetDifference = 1000, // 1s wait after show channel history before sending getChannelDifference
+	DifferenceApplyInstantCount = 200, // smaller differences are applied at once, bigger are applied in chunks
+	DifferenceApplyChunkTime = 8, // 8ms of gui thread for applying one chunk of a big difference
+	DifferenceApplyChunkMessages = 20, // feed new messages of a big difference by 20
 
 	MemoryForImageCache = 64 * 1024 * 1024, // after 64mb of unpacked images we try to clear some memory
 	NotifyWindowsCount = 3, // 3 desktop notifies at the same time
@@ -1016,17 +1016,97 @@ struct ComposerMetadatasMap {
 	}
 };
 
-const ComposerMetadata *GetComposerMetadata(uint64 mask) {
-	static ComposerMetadatasMap ComposerMetadatas;
-	static QMutex ComposerMetadatasMutex;
+namespace {
+
+// Function local statics, because metadata can be requested from other
+// global objects constructors.
+ComposerMetadatasMap &ComposerMetadatas() {
+	static ComposerMetadatasMap result;
+	return result;
+}
+
+QMutex &ComposerMetadatasMutex() {
+	static QMutex result;
+	return result;
+}
+
+constexpr int ComposerSlabSize = 4096;
+
+} // namespace
+
+void *ComposerMetadata::allocate() const {
+	if (!_freeBlocks) {
+		allocateSlab();
+	}
+	auto result = _freeBlocks;
+	_freeBlocks = *static_cast<void**>(result);
+	++_alive;
+	return result;
+}
+
+void ComposerMetadata::deallocate(void *data) const {
+	*static_cast<void**>(data) = _freeBlocks;
+	_freeBlocks = data;
+	if (!--_alive && _slabs.size() > 1) {
+		// All the blocks are free, keep only the first slab for the next composers.
+		for (auto i = _slabs.cbegin() + 1, e = _slabs.cend(); i != e; ++i) {
+			operator delete(*i);
+		}
+		_slabs.resize(1);
+		_freeBlocks = nullptr;
+		linkSlab(static_cast<char*>(_slabs.front()));
+	}
+}
 
-	QMutexLocker lock(&ComposerMetadatasMutex);
-	auto i = ComposerMetadatas.data.constFind(mask);
-	if (i == ComposerMetadatas.data.cend()) {
+void ComposerMetadata::allocateSlab() const {
+	auto slab = static_cast<char*>(operator new(slabBlocksCount() * blockSize()));
+	_slabs.push_back(slab);
+	linkSlab(slab);
+}
+
+void ComposerMetadata::linkSlab(char *slab) const {
+	auto block = blockSize();
+
+	// Link the blocks in the address order.
+	for (auto i = slabBlocksCount(); i > 0;) {
+		--i;
+		auto data = slab + i * block;
+		*reinterpret_cast<void**>(data) = _freeBlocks;
+		_freeBlocks = data;
+	}
+}
+
+int ComposerMetadata::slabBlocksCount() const {
+	return qMax(ComposerSlabSize / blockSize(), 1);
+}
+
+ComposerMetadata::~ComposerMetadata() {
+	for_const (auto slab, _slabs) {
+		operator delete(slab);
+	}
+}
+
+QVector<ComposerMetadataStats> GetComposerMetadataStats() {
+	QVector<ComposerMetadataStats> result;
+
+	QMutexLocker lock(&ComposerMetadatasMutex());
+	result.reserve(ComposerMetadatas().data.size());
+	for_const (const ComposerMetadata *meta, ComposerMetadatas().data) {
+		auto block = meta->blockSize();
+		auto slab = meta->slabBlocksCount() * block;
+		result.push_back({ meta->_mask, meta->_alive, int64(meta->_alive) * block, int64(meta->_slabs.size()) * slab });
+	}
+	return result;
+}
+
+const ComposerMetadata *GetComposerMetadata(uint64 mask) {
+	QMutexLocker lock(&ComposerMetadatasMutex());
+	auto i = ComposerMetadatas().data.constFind(mask);
+	if (i == ComposerMetadatas().data.cend()) {
 		ComposerMetadata *meta = new ComposerMetadata(mask);
 		t_assert(meta != nullptr);
 
-		i = ComposerMetadatas.data.insert(mask, meta);
+		i = ComposerMetadatas().data.insert(mask, meta);
 	}
 	return i.value();
 }
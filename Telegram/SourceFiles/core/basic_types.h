@@ -1028,6 +1028,7 @@ protected:
 
 };
 
+struct ComposerMetadataStats;
 class ComposerMetadata {
 public:
 
@@ -1066,21 +1067,51 @@ public:
 		return _mask & (~mask);
 	}
 
+	// Composer data blocks of this layout are taken from pooled slabs.
+	void *allocate() const;
+	void deallocate(void *data) const;
+
+	~ComposerMetadata();
+
 private:
+	friend QVector<ComposerMetadataStats> GetComposerMetadataStats();
+
+	int blockSize() const {
+		return (int(sizeof(ComposerMetadata*)) + size + 7) & ~7; // keep uint64 components aligned
+	}
+	int slabBlocksCount() const;
+	void allocateSlab() const;
+	void linkSlab(char *slab) const;
+
 	uint64 _mask;
 
+	// The pool is not a part of the layout description, so it is mutable.
+	// Composers are created and destroyed only in the main thread, the worker
+	// threads measuring history items while resizing only read them, so the
+	// pool is not locked.
+	mutable void *_freeBlocks = nullptr; // each free block starts with a pointer to the next one
+	mutable QVector<void*> _slabs;
+	mutable int _alive = 0;
+
 };
 
 const ComposerMetadata *GetComposerMetadata(uint64 mask);
 
+struct ComposerMetadataStats {
+	uint64 mask;
+	int alive; // composers with this layout
+	int64 usedBytes; // taken by alive composers
+	int64 allocatedBytes; // taken by all the slabs of this layout
+};
+QVector<ComposerMetadataStats> GetComposerMetadataStats();
+
 class Composer {
 public:
 
 	Composer(uint64 mask = 0) : _data(zerodata()) {
 		if (mask) {
 			const ComposerMetadata *meta = GetComposerMetadata(mask);
-			int size = sizeof(meta) + meta->size;
-			void *data = operator new(size);
+			void *data = meta->allocate();
 			if (!data) { // terminate if we can't allocate memory
 				throw "Can't allocate memory!";
 			}
@@ -1117,7 +1148,7 @@ public:
 					ComponentWraps[i].Destruct(_dataptrunsafe(offset));
 				}
 			}
-			operator delete(_data);
+			meta->deallocate(_data);
 		}
 	}
 
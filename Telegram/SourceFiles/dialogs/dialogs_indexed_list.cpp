@@ -22,6 +22,34 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 #include "dialogs/dialogs_indexed_list.h"
 
 namespace Dialogs {
+namespace {
+
+// Checks if some prefix of the name equals the word with one typo:
+// one letter replaced, missing or extra or two adjacent letters swapped.
+bool startsWithTypo(const QString &name, const QString &word) {
+	int nameSize = name.size(), wordSize = word.size(), same = 0;
+	while (same < nameSize && same < wordSize && name.at(same) == word.at(same)) {
+		++same;
+	}
+	if (same == wordSize) {
+		return true;
+	}
+	auto restStartsWith = [&name, &word, nameSize, wordSize](int nameFrom, int wordFrom) {
+		if (wordFrom >= wordSize) return true;
+		if (nameFrom >= nameSize) return false;
+		return name.midRef(nameFrom).startsWith(word.midRef(wordFrom));
+	};
+	if (same < nameSize && restStartsWith(same + 1, same + 1)) { // replaced
+		return true;
+	} else if (restStartsWith(same, same + 1)) { // extra
+		return true;
+	} else if (same < nameSize && restStartsWith(same + 1, same)) { // missing
+		return true;
+	}
+	return (same + 1 < nameSize && same + 1 < wordSize && name.at(same) == word.at(same + 1) && name.at(same + 1) == word.at(same) && restStartsWith(same + 2, same + 2)); // swapped
+}
+
+} // namespace
 
 IndexedList::IndexedList(SortMode sortMode)
 : _sortMode(sortMode)
@@ -32,6 +60,7 @@ RowsByLetter IndexedList::addToEnd(History *history) {
 	RowsByLetter result;
 	if (!_list.contains(history->peer->id)) {
 		result.insert(0, _list.addToEnd(history));
+		addWords(history->peer);
 		for_const (auto ch, history->peer->chars) {
 			auto j = _index.find(ch);
 			if (j == _index.cend()) {
@@ -49,6 +78,7 @@ Row *IndexedList::addByName(History *history) {
 	}
 
 	Row *result = _list.addByName(history);
+	addWords(history->peer);
 	for_const (auto ch, history->peer->chars) {
 		auto j = _index.find(ch);
 		if (j == _index.cend()) {
@@ -73,6 +103,10 @@ void IndexedList::adjustByPos(const RowsByLetter &links) {
 
 void IndexedList::peerNameChanged(PeerData *peer, const PeerData::Names &oldNames, const PeerData::NameFirstChars &oldChars) {
 	t_assert(_sortMode != SortMode::Date);
+	if (_list.contains(peer->id)) {
+		removeWords(peer->id, oldNames);
+		addWords(peer);
+	}
 	if (_sortMode == SortMode::Name) {
 		adjustByName(peer, oldNames, oldChars);
 	} else {
@@ -82,6 +116,10 @@ void IndexedList::peerNameChanged(PeerData *peer, const PeerData::Names &oldName
 
 void IndexedList::peerNameChanged(Mode list, PeerData *peer, const PeerData::Names &oldNames, const PeerData::NameFirstChars &oldChars) {
 	t_assert(_sortMode == SortMode::Date);
+	if (_list.contains(peer->id)) {
+		removeWords(peer->id, oldNames);
+		addWords(peer);
+	}
 	adjustNames(list, peer, oldNames, oldChars);
 }
 
@@ -156,6 +194,7 @@ void IndexedList::adjustNames(Mode list, PeerData *peer, const PeerData::Names &
 
 void IndexedList::del(const PeerData *peer, Row *replacedBy) {
 	if (_list.del(peer->id, replacedBy)) {
+		removeWords(peer->id, peer->names);
 		for_const (auto ch, peer->chars) {
 			if (auto list = _index.value(ch)) {
 				list->del(peer->id, replacedBy);
@@ -168,6 +207,94 @@ void IndexedList::clear() {
 	for_const (auto &list, _index) {
 		delete list;
 	}
+	_words.clear();
+}
+
+QVector<Row*> IndexedList::filtered(const QStringList &words) const {
+	QVector<Row*> result;
+	if (words.isEmpty() || _list.isEmpty()) {
+		return result;
+	}
+
+	QSet<PeerId> found;
+	for (int i = 0, l = words.size(); i != l; ++i) {
+		auto byWord = findByPrefix(words.at(i));
+		if (byWord.isEmpty()) {
+			byWord = findByPrefixWithTypo(words.at(i));
+		}
+		if (i) {
+			found.intersect(byWord);
+		} else {
+			found = byWord;
+		}
+		if (found.isEmpty()) {
+			return result;
+		}
+	}
+
+	result.reserve(found.size());
+	if (found.size() * 8 > _list.size()) {
+		for_const (auto row, _list) {
+			if (found.contains(row->history()->peer->id)) {
+				result.push_back(row);
+			}
+		}
+	} else {
+		QVector<QPair<int, Row*>> ordered;
+		ordered.reserve(found.size());
+		for_const (auto peerId, found) {
+			if (auto row = _list.getRow(peerId)) {
+				ordered.push_back(qMakePair(row->pos(), row));
+			}
+		}
+		std::sort(ordered.begin(), ordered.end());
+		for_const (auto &pair, ordered) {
+			result.push_back(pair.second);
+		}
+	}
+	return result;
+}
+
+void IndexedList::addWords(PeerData *peer) {
+	for_const (auto &name, peer->names) {
+		_words[name].insert(peer->id);
+	}
+}
+
+void IndexedList::removeWords(PeerId peerId, const PeerData::Names &names) {
+	for_const (auto &name, names) {
+		auto i = _words.find(name);
+		if (i != _words.cend()) {
+			i.value().remove(peerId);
+			if (i.value().isEmpty()) {
+				_words.erase(i);
+			}
+		}
+	}
+}
+
+QSet<PeerId> IndexedList::findByPrefix(const QString &word) const {
+	QSet<PeerId> result;
+	for (auto i = _words.lowerBound(word), e = _words.cend(); i != e && i.key().startsWith(word); ++i) {
+		result.unite(i.value());
+	}
+	return result;
+}
+
+QSet<PeerId> IndexedList::findByPrefixWithTypo(const QString &word) const {
+	QSet<PeerId> result;
+	if (word.size() < FilterTypoMinLength) {
+		return result;
+	}
+
+	// The first letter is not expected to be mistyped.
+	auto first = word.at(0);
+	for (auto i = _words.lowerBound(QString(first)), e = _words.cend(); i != e && i.key().at(0) == first; ++i) {
+		if (startsWithTypo(i.key(), word)) {
+			result.unite(i.value());
+		}
+	}
+	return result;
 }
 
 IndexedList::~IndexedList() {
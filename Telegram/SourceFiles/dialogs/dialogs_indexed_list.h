@@ -52,6 +52,10 @@ public:
 		return _index.value(ch, empty.data());
 	}
 
+	// Rows having a name starting with each of the words, in the list order.
+	// If nothing starts with some word, names differing from it by one typo are matched.
+	QVector<Row*> filtered(const QStringList &words) const;
+
 	~IndexedList();
 
 	// Part of List interface is duplicated here for all() list.
@@ -80,11 +84,20 @@ private:
 	void adjustByName(PeerData *peer, const PeerData::Names &oldNames, const PeerData::NameFirstChars &oldChars);
 	void adjustNames(Mode list, PeerData *peer, const PeerData::Names &oldNames, const PeerData::NameFirstChars &oldChars);
 
+	void addWords(PeerData *peer);
+	void removeWords(PeerId peerId, const PeerData::Names &names);
+	QSet<PeerId> findByPrefix(const QString &word) const;
+	QSet<PeerId> findByPrefixWithTypo(const QString &word) const;
+
 	SortMode _sortMode;
 	List _list;
 	using Index = QMap<QChar, List*>;
 	Index _index;
 
+	// All name words of all peers in _list, sorted for the prefix lookups.
+	using Words = QMap<QString, QSet<PeerId>>;
+	Words _words;
+
 };
 
 } // namespace Dialogs
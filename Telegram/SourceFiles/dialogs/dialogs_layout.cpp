@@ -225,13 +225,109 @@ void paintUnreadCount(Painter &p, const QString &text, int x, int y, const Unrea
 	p.drawText(unreadRectLeft + (unreadRectWidth - unreadWidth) / 2, unreadRectTop + st::dialogsUnreadTop + st.font->ascent, text);
 }
 
-void RowPainter::paint(Painter &p, const Row *row, int w, bool active, bool selected, bool onlyBackground) {
+namespace {
+
+// Painted row raster is reused while all the painted data is the same.
+struct RowCacheKey {
+	int width = 0;
+	bool active = false;
+	bool selected = false;
+	HistoryItem *item = nullptr;
+	MsgId itemId = 0;
+	bool itemUnread = false;
+	bool itemTextCached = false;
+	Data::Draft *draft = nullptr;
+	bool draftSaving = false;
+	bool draftTextCached = false;
+	QDateTime date;
+	QDate today;
+	int unreadCount = 0;
+	bool muted = false;
+	int nameVersion = 0;
+	bool verified = false;
+	StorageKey userpic;
+};
+inline bool operator==(const RowCacheKey &a, const RowCacheKey &b) {
+	return (a.width == b.width)
+		&& (a.active == b.active)
+		&& (a.selected == b.selected)
+		&& (a.item == b.item)
+		&& (a.itemId == b.itemId)
+		&& (a.itemUnread == b.itemUnread)
+		&& (a.itemTextCached == b.itemTextCached)
+		&& (a.draft == b.draft)
+		&& (a.draftSaving == b.draftSaving)
+		&& (a.draftTextCached == b.draftTextCached)
+		&& (a.date == b.date)
+		&& (a.today == b.today)
+		&& (a.unreadCount == b.unreadCount)
+		&& (a.muted == b.muted)
+		&& (a.nameVersion == b.nameVersion)
+		&& (a.verified == b.verified)
+		&& (a.userpic == b.userpic);
+}
+inline bool operator!=(const RowCacheKey &a, const RowCacheKey &b) {
+	return !(a == b);
+}
+
+struct RowCache {
+	RowCacheKey key;
+	QPixmap pixmap;
+	uint64 lastUsed = 0;
+};
+using RowCaches = QHash<const Row*, RowCache>;
+NeverFreedPointer<RowCaches> rowCaches;
+uint64 rowCachesUsed = 0;
+
+Data::Draft *rowDraft(History *history) {
+	auto cloudDraft = history->cloudDraft();
+	return Data::draftIsNull(cloudDraft) ? nullptr : cloudDraft;
+}
+
+int rowUnreadCount(History *history) {
+	int result = history->unreadCount();
+	if (history->peer->migrateFrom()) {
+		if (auto migrated = App::historyLoaded(history->peer->migrateFrom()->id)) {
+			result += migrated->unreadCount();
+		}
+	}
+	return result;
+}
+
+RowCacheKey rowCacheKey(const Row *row, int w, bool active, bool selected) {
 	auto history = row->history();
 	auto item = history->lastMsg;
-	auto cloudDraft = history->cloudDraft();
-	if (Data::draftIsNull(cloudDraft)) {
-		cloudDraft = nullptr;
+	auto draft = rowDraft(history);
+	auto userpicPeer = (history->peer->migrateTo() ? history->peer->migrateTo() : history->peer);
+
+	RowCacheKey result;
+	result.width = w;
+	result.active = active;
+	result.selected = selected;
+	result.item = item;
+	result.itemId = item ? item->id : 0;
+	result.itemUnread = item ? item->unread() : false;
+	result.itemTextCached = item ? (history->textCachedFor == item) : false;
+	result.draft = draft;
+	result.draftSaving = draft ? (draft->saveRequestId != 0) : false;
+	result.draftTextCached = !history->cloudDraftTextCache.isEmpty();
+	result.date = item ? item->date : QDateTime();
+	if (draft && draft->date > result.date) {
+		result.date = draft->date;
 	}
+	result.today = QDate::currentDate();
+	result.unreadCount = rowUnreadCount(history);
+	result.muted = history->mute();
+	result.nameVersion = history->peer->nameVersion;
+	result.verified = history->peer->isVerified();
+	result.userpic = userpicPeer->userpicUniqueKey();
+	return result;
+}
+
+void paintDialogRow(Painter &p, const Row *row, int w, bool active, bool selected, bool onlyBackground) {
+	auto history = row->history();
+	auto item = history->lastMsg;
+	auto cloudDraft = rowDraft(history);
 	auto displayDate = [item, cloudDraft]() {
 		if (item) {
 			if (cloudDraft) {
@@ -241,12 +337,7 @@ void RowPainter::paint(Painter &p, const Row *row, int w, bool active, bool sele
 		}
 		return cloudDraft ? cloudDraft->date : QDateTime();
 	};
-	int unreadCount = history->unreadCount();
-	if (history->peer->migrateFrom()) {
-		if (auto migrated = App::historyLoaded(history->peer->migrateFrom()->id)) {
-			unreadCount += migrated->unreadCount();
-		}
-	}
+	int unreadCount = rowUnreadCount(history);
 
 	if (item && cloudDraft && unreadCount > 0) {
 		cloudDraft = nullptr; // Draw item, if draft is older.
@@ -276,6 +367,54 @@ void RowPainter::paint(Painter &p, const Row *row, int w, bool active, bool sele
 	});
 }
 
+} // namespace
+
+void RowPainter::paint(Painter &p, const Row *row, int w, bool active, bool selected, bool onlyBackground) {
+	auto history = row->history();
+	if (onlyBackground || !history->typing.isEmpty() || !history->sendActions.isEmpty()) {
+		// Typing is animated, so there is nothing to reuse.
+		clearCache(row);
+		paintDialogRow(p, row, w, active, selected, onlyBackground);
+		return;
+	}
+
+	rowCaches.makeIfNull();
+	auto &cache = (*rowCaches)[row];
+	auto key = rowCacheKey(row, w, active, selected);
+	if (cache.pixmap.isNull() || cache.key != key) {
+		QSize size(w * cIntRetinaFactor(), st::dialogsRowHeight * cIntRetinaFactor());
+		if (cache.pixmap.size() != size) {
+			cache.pixmap = QPixmap(size);
+			cache.pixmap.setDevicePixelRatio(cRetinaFactor());
+		}
+		{
+			Painter cachePainter(&cache.pixmap);
+			paintDialogRow(cachePainter, row, w, active, selected, false);
+		}
+
+		// Painting fills the last message and draft text caches, take the key after it.
+		cache.key = rowCacheKey(row, w, active, selected);
+	}
+	cache.lastUsed = ++rowCachesUsed;
+	p.drawPixmap(0, 0, cache.pixmap);
+
+	if (rowCaches->size() > DialogsRowCachesCount) {
+		auto oldest = rowCaches->begin();
+		for (auto i = rowCaches->begin(), e = rowCaches->end(); i != e; ++i) {
+			if (i.value().lastUsed < oldest.value().lastUsed) {
+				oldest = i;
+			}
+		}
+		rowCaches->erase(oldest);
+	}
+}
+
+void RowPainter::clearCache(const Row *row) {
+	if (rowCaches) {
+		rowCaches->remove(row);
+	}
+}
+
 void RowPainter::paint(Painter &p, const FakeRow *row, int w, bool active, bool selected, bool onlyBackground) {
 	auto item = row->item();
 	auto history = item->history();
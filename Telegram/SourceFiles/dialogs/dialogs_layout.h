@@ -31,6 +31,9 @@ class RowPainter {
 public:
 	static void paint(Painter &p, const Row *row, int w, bool active, bool selected, bool onlyBackground);
 	static void paint(Painter &p, const FakeRow *row, int w, bool active, bool selected, bool onlyBackground);
+
+	// Dialogs rows are painted to cached rasters, call it when the row is destroyed.
+	static void clearCache(const Row *row);
 };
 
 void paintImportantSwitch(Painter &p, Mode current, int w, bool selected, bool onlyBackground);
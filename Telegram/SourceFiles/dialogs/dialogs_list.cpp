@@ -26,108 +26,106 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 #include "mainwidget.h"
 
 namespace Dialogs {
+namespace {
+
+// Both adding and adjusting rows by name must use the same order.
+int compareNames(const QString &a, const QString &b) {
+	return a.compare(b, Qt::CaseInsensitive);
+}
+
+} // namespace
 
 List::List(SortMode sortMode)
-: _last(std_::make_unique<Row>(nullptr, nullptr, nullptr, 0))
+: _last(std_::make_unique<Row>(nullptr))
 , _begin(_last.get())
 , _end(_last.get())
-, _sortMode(sortMode)
-, _current(_last.get()) {
+, _sortMode(sortMode) {
 }
 
-void List::adjustCurrent(int32 y, int32 h) const {
-	if (isEmpty()) return;
-
-	int32 pos = (y > 0) ? (y / h) : 0;
-	while (_current->_pos > pos && _current != _begin) {
-		_current = _current->_prev;
-	}
-	while (_current->_pos + 1 <= pos && _current->_next != _end) {
-		_current = _current->_next;
+Row *List::rowAt(int pos) const {
+	t_assert(pos >= 0 && pos < _count);
+
+	auto row = _root;
+	while (true) {
+		auto leftSize = subtreeSize(row->_left);
+		if (pos < leftSize) {
+			row = row->_left;
+		} else if (pos > leftSize) {
+			pos -= leftSize + 1;
+			row = row->_right;
+		} else {
+			return row;
+		}
 	}
 }
 
+Row *List::findByY(int y, int h) const {
+	if (isEmpty()) return _end;
+
+	int pos = (y > 0) ? (y / h) : 0;
+	return rowAt(qMin(pos, _count - 1));
+}
+
 void List::paint(Painter &p, int32 w, int32 hFrom, int32 hTo, PeerData *act, PeerData *sel, bool onlyBackground) const {
-	adjustCurrent(hFrom, st::dialogsRowHeight);
+	if (isEmpty()) return;
 
-	Row *row = _current;
-	p.translate(0, row->_pos * st::dialogsRowHeight);
-	while (row != _end && row->_pos * st::dialogsRowHeight < hTo) {
+	Row *row = findByY(hFrom, st::dialogsRowHeight);
+	int pos = row->pos();
+	p.translate(0, pos * st::dialogsRowHeight);
+	while (row != _end && pos * st::dialogsRowHeight < hTo) {
 		bool active = (row->history()->peer == act) || (row->history()->peer->migrateTo() && row->history()->peer->migrateTo() == act);
 		bool selected = (row->history()->peer == sel);
 		Layout::RowPainter::paint(p, row, w, active, selected, onlyBackground);
 		row = row->_next;
+		++pos;
 		p.translate(0, st::dialogsRowHeight);
 	}
 }
 
 Row *List::addToEnd(History *history) {
-	Row *result = new Row(history, _end->_prev, _end, _end->_pos);
-	_end->_pos++;
-	if (_begin == _end) {
-		_begin = _current = result;
-	} else {
-		_end->_prev->_next = result;
-	}
+	Row *result = new Row(history);
+	insertAt(result, _count);
 	_rowByPeer.insert(history->peer->id, result);
 	++_count;
-	_end->_prev = result;
 	if (_sortMode == SortMode::Date) {
 		adjustByPos(result);
 	}
 	return result;
 }
 
-bool List::insertBefore(Row *row, Row *before) {
-	if (row == before) return false;
-
-	if (_current == row) {
-		_current = row->_prev;
-	}
-
-	Row *updateTill = row->_prev;
-	remove(row);
-
-	// insert row
-	row->_next = before; // update row
-	row->_prev = before->_prev;
-	row->_next->_prev = row; // update row->next
-	if (row->_prev) { // update row->prev
-		row->_prev->_next = row;
-	} else {
-		_begin = row;
-	}
-
-	// update y
-	for (Row *n = row; n != updateTill; n = n->_next) {
-		n->_next->_pos++;
-		row->_pos--;
+template <typename Predicate>
+int List::countPrefix(Predicate predicate) const {
+	int result = 0;
+	for (auto row = _root; row;) {
+		if (predicate(row)) {
+			result += subtreeSize(row->_left) + 1;
+			row = row->_right;
+		} else {
+			row = row->_left;
+		}
 	}
-	return true;
+	return result;
 }
 
-bool List::insertAfter(Row *row, Row *after) {
-	if (row == after) return false;
-
-	if (_current == row) {
-		_current = row->_next;
+template <typename Compare>
+void List::reposition(Row *row, Compare compare) {
+	bool prevGood = !row->_prev || (compare(row->_prev) <= 0);
+	bool nextGood = (row->_next == _end) || (compare(row->_next) >= 0);
+	if (prevGood && nextGood) {
+		return;
 	}
 
-	Row *updateFrom = row->_next;
+	// Keep the row as close to its old place as possible between the rows
+	// that must be before it and the rows that must be after it.
+	int from = row->pos();
 	remove(row);
-
-	// insert row
-	row->_prev = after; // update row
-	row->_next = after->_next;
-	row->_prev->_next = row; // update row->prev
-	row->_next->_prev = row; // update row->next
-
-	// update y
-	for (Row *n = updateFrom; n != row; n = n->_next) {
-		n->_pos--;
-		row->_pos++;
-	}
-	return true;
+	int before = countPrefix([&compare](Row *other) {
+		return compare(other) < 0;
+	});
+	int notAfter = countPrefix([&compare](Row *other) {
+		return compare(other) <= 0;
+	});
+	insertAt(row, snap(from, before, notAfter));
 }
 
 Row *List::adjustByName(const PeerData *peer) {
@@ -136,57 +134,33 @@ Row *List::adjustByName(const PeerData *peer) {
 	auto i = _rowByPeer.find(peer->id);
 	if (i == _rowByPeer.cend()) return nullptr;
 
-	Row *row = i.value(), *change = row;
-	while (change->_prev && change->_prev->history()->peer->name > peer->name) {
-		change = change->_prev;
-	}
-	if (!insertBefore(row, change)) {
-		while (change->_next != _end && change->_next->history()->peer->name < peer->name) {
-			change = change->_next;
-		}
-		insertAfter(row, change);
-	}
+	Row *row = i.value();
+	const QString &peerName(peer->name);
+	reposition(row, [&peerName](Row *other) {
+		return compareNames(other->history()->peer->name, peerName);
+	});
 	return row;
 }
 
 Row *List::addByName(History *history) {
 	if (_sortMode != SortMode::Name) return nullptr;
 
-	Row *row = addToEnd(history), *change = row;
+	Row *row = addToEnd(history);
 	const QString &peerName(history->peer->name);
-	while (change->_prev && change->_prev->history()->peer->name.compare(peerName, Qt::CaseInsensitive) > 0) {
-		change = change->_prev;
-	}
-	if (!insertBefore(row, change)) {
-		while (change->_next != _end && change->_next->history()->peer->name.compare(peerName, Qt::CaseInsensitive) < 0) {
-			change = change->_next;
-		}
-		insertAfter(row, change);
-	}
+	reposition(row, [&peerName](Row *other) {
+		return compareNames(other->history()->peer->name, peerName);
+	});
 	return row;
 }
 
 void List::adjustByPos(Row *row) {
-	if (_sortMode != SortMode::Date || !_begin) return;
+	if (_sortMode != SortMode::Date || isEmpty()) return;
 
-	Row *change = row;
-	if (change != _begin && _begin->history()->sortKeyInChatList() < row->history()->sortKeyInChatList()) {
-		change = _begin;
-	} else {
-		while (change->_prev && change->_prev->history()->sortKeyInChatList() < row->history()->sortKeyInChatList()) {
-			change = change->_prev;
-		}
-	}
-	if (!insertBefore(row, change)) {
-		if (change->_next != _end && _end->_prev->history()->sortKeyInChatList() > row->history()->sortKeyInChatList()) {
-			change = _end->_prev;
-		} else {
-			while (change->_next != _end && change->_next->history()->sortKeyInChatList() > row->history()->sortKeyInChatList()) {
-				change = change->_next;
-			}
-		}
-		insertAfter(row, change);
-	}
+	auto key = row->history()->sortKeyInChatList();
+	reposition(row, [key](Row *other) {
+		auto otherKey = other->history()->sortKeyInChatList();
+		return (otherKey > key) ? -1 : ((otherKey < key) ? 1 : 0);
+	});
 }
 
 bool List::del(PeerId peerId, Row *replacedBy) {
@@ -198,13 +172,6 @@ bool List::del(PeerId peerId, Row *replacedBy) {
 		emit App::main()->dialogRowReplaced(row, replacedBy);
 	}
 
-	if (row == _current) {
-		_current = row->_next;
-	}
-	for (Row *change = row->_next; change != _end; change = change->_next) {
-		--change->_pos;
-	}
-	--_end->_pos;
 	remove(row);
 	delete row;
 	--_count;
@@ -213,7 +180,47 @@ bool List::del(PeerId peerId, Row *replacedBy) {
 	return true;
 }
 
+void List::insertAt(Row *row, int pos) {
+	Row *next = (pos < subtreeSize(_root)) ? rowAt(pos) : _end;
+
+	// insert to the linked list
+	row->_next = next;
+	row->_prev = next->_prev;
+	next->_prev = row;
+	if (row->_prev) {
+		row->_prev->_next = row;
+	} else {
+		_begin = row;
+	}
+
+	// insert to the tree
+	if (!row->_priority) {
+		_priorityState ^= _priorityState << 13; // xorshift32
+		_priorityState ^= _priorityState >> 17;
+		_priorityState ^= _priorityState << 5;
+		row->_priority = _priorityState;
+	}
+	row->_parent = row->_left = row->_right = nullptr;
+	row->_size = 1;
+
+	Row *left = nullptr, *right = nullptr;
+	split(_root, pos, left, right);
+	_root = merge(merge(left, row), right);
+	_root->_parent = nullptr;
+}
+
 void List::remove(Row *row) {
+	int pos = row->pos();
+
+	// remove from the tree
+	Row *left = nullptr, *middle = nullptr, *right = nullptr;
+	split(_root, pos, left, right);
+	split(right, 1, middle, right);
+	t_assert(middle == row);
+	_root = merge(left, right);
+	if (_root) _root->_parent = nullptr;
+
+	// remove from the linked list
 	row->_next->_prev = row->_prev; // update row->next
 	if (row->_prev) { // update row->prev
 		row->_prev->_next = row->_next;
@@ -222,13 +229,51 @@ void List::remove(Row *row) {
 	}
 }
 
+void List::updateSubtree(Row *row) {
+	row->_size = 1 + subtreeSize(row->_left) + subtreeSize(row->_right);
+	if (row->_left) row->_left->_parent = row;
+	if (row->_right) row->_right->_parent = row;
+}
+
+void List::split(Row *row, int count, Row *&left, Row *&right) {
+	if (!row) {
+		left = right = nullptr;
+		return;
+	}
+	if (subtreeSize(row->_left) < count) {
+		split(row->_right, count - subtreeSize(row->_left) - 1, row->_right, right);
+		updateSubtree(row);
+		left = row;
+	} else {
+		split(row->_left, count, left, row->_left);
+		updateSubtree(row);
+		right = row;
+	}
+	if (left) left->_parent = nullptr;
+	if (right) right->_parent = nullptr;
+}
+
+Row *List::merge(Row *left, Row *right) {
+	if (!left) return right;
+	if (!right) return left;
+	if (left->_priority > right->_priority) {
+		left->_right = merge(left->_right, right);
+		updateSubtree(left);
+		return left;
+	}
+	right->_left = merge(left, right->_left);
+	updateSubtree(right);
+	return right;
+}
+
 void List::clear() {
 	while (_begin != _end) {
-		_current = _begin;
+		Row *row = _begin;
 		_begin = _begin->_next;
-		delete _current;
+		delete row;
 	}
-	_current = _begin;
+	_end->_prev = nullptr;
+	_root = nullptr;
 	_rowByPeer.clear();
 	_count = 0;
 }
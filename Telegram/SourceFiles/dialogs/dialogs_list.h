@@ -44,22 +44,17 @@ public:
 		return _rowByPeer.value(peerId);
 	}
 	Row *rowAtY(int32 y, int32 h) const {
-		auto i = cfind(y, h);
-		if (i == cend() || (*i)->pos() != ((y > 0) ? (y / h) : 0)) {
-			return nullptr;
-		}
-		return *i;
+		int pos = (y > 0) ? (y / h) : 0;
+		return (pos < _count) ? rowAt(pos) : nullptr;
 	}
+	Row *rowAt(int pos) const; // O(log(n))
 
 	void paint(Painter &p, int32 w, int32 hFrom, int32 hTo, PeerData *act, PeerData *sel, bool onlyBackground) const;
 	Row *addToEnd(History *history);
-	bool insertBefore(Row *row, Row *before);
-	bool insertAfter(Row *row, Row *after);
 	Row *adjustByName(const PeerData *peer);
 	Row *addByName(History *history);
 	void adjustByPos(Row *row);
 	bool del(PeerId peerId, Row *replacedBy = nullptr);
-	void remove(Row *row);
 	void clear();
 
 	class const_iterator {
@@ -100,20 +95,15 @@ public:
 	const_iterator cfind(Row *value) const { return value ? const_iterator(value) : cend(); }
 	const_iterator find(Row *value) const { return cfind(value); }
 	iterator find(Row *value) { return value ? iterator(value) : end(); }
-	const_iterator cfind(int y, int h) const {
-		adjustCurrent(y, h);
-		return iterator(_current);
-	}
+	const_iterator cfind(int y, int h) const { return const_iterator(findByY(y, h)); }
 	const_iterator find(int y, int h) const { return cfind(y, h); }
-	iterator find(int y, int h) {
-		adjustCurrent(y, h);
-		return iterator(_current);
-	}
+	iterator find(int y, int h) { return iterator(findByY(y, h)); }
 
 	~List();
 
 private:
-	void adjustCurrent(int y, int h) const;
+	// Returns the row at y or the last row if y is below the list end.
+	Row *findByY(int y, int h) const;
 	static Row *next(Row *row) {
 		return row->_next;
 	}
@@ -121,16 +111,35 @@ private:
 		return row->_prev;
 	}
 
+	// Moves the row to its sorted place, compare(other) < 0 means that
+	// the other row must be before this row and > 0 that it must be after.
+	template <typename Compare>
+	void reposition(Row *row, Compare compare);
+
+	template <typename Predicate>
+	int countPrefix(Predicate predicate) const;
+
+	void insertAt(Row *row, int pos);
+	void remove(Row *row);
+
+	static int subtreeSize(Row *row) {
+		return row ? row->_size : 0;
+	}
+	static void updateSubtree(Row *row);
+	static void split(Row *row, int count, Row *&left, Row *&right);
+	static Row *merge(Row *left, Row *right);
+
 	std_::unique_ptr<Row> _last;
 	Row *_begin;
 	Row *_end;
+	Row *_root = nullptr;
 	SortMode _sortMode;
 	int _count = 0;
+	uint32 _priorityState = 0x9E3779B9U;
 
 	typedef QHash<PeerId, Row*> RowByPeer;
 	RowByPeer _rowByPeer;
 
-	mutable Row *_current; // cache
 };
 
 } // namespace Dialogs
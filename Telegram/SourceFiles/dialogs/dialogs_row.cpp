@@ -21,10 +21,26 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 #include "stdafx.h"
 #include "dialogs/dialogs_row.h"
 
+#include "dialogs/dialogs_layout.h"
 #include "styles/style_dialogs.h"
 
 namespace Dialogs {
 
+Row::~Row() {
+	Layout::RowPainter::clearCache(this);
+}
+
+int Row::pos() const {
+	auto result = _left ? _left->_size : 0;
+	for (auto row = this; row->_parent; row = row->_parent) {
+		auto parent = row->_parent;
+		if (row == parent->_right) {
+			result += (parent->_left ? parent->_left->_size : 0) + 1;
+		}
+	}
+	return result;
+}
+
 FakeRow::FakeRow(HistoryItem *item) : _item(item), _cache(st::dialogsTextWidthMin) {
 }
 
@@ -33,27 +33,31 @@ class RowPainter;
 class List;
 class Row {
 public:
-	Row(History *history, Row *prev, Row *next, int pos)
-		: _history(history)
-		, _prev(prev)
-		, _next(next)
-		, _pos(pos) {
+	explicit Row(History *history) : _history(history) {
 	}
+	~Row();
+
 	void *attached = nullptr; // for any attached data, for example View in contacts list
 
 	History *history() const {
 		return _history;
 	}
-	int pos() const {
-		return _pos;
-	}
+	int pos() const; // O(log(n)), computed from the List tree
 
 private:
 	friend class List;
 
 	History *_history;
-	Row *_prev, *_next;
-	int _pos;
+	Row *_prev = nullptr;
+	Row *_next = nullptr;
+
+	// List keeps its rows in a treap by position as well, so that
+	// row <-> position lookups and moves are logarithmic.
+	Row *_parent = nullptr;
+	Row *_left = nullptr;
+	Row *_right = nullptr;
+	int _size = 1; // rows count in this subtree
+	uint32 _priority = 0;
 
 };
 
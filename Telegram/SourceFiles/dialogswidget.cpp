@@ -77,6 +77,7 @@ int DialogsInner::searchedOffset() const {
 void DialogsInner::paintRegion(Painter &p, const QRegion &region, bool paintingOther) {
 	QRegion original(rtl() ? region.translated(-otherWidth(), 0) : region);
 	if (App::wnd() && App::wnd()->contentOverlapped(this, original)) return;
+	TRACE_SCOPE("DialogsInner::paintRegion");
 
 	if (!App::main()) return;
 
@@ -799,78 +800,11 @@ void DialogsInner::onFilterUpdate(QString newFilter, bool force) {
 				_lastSearchPeer = 0;
 				_lastSearchId = _lastSearchMigratedId = 0;
 			} else {
-				QStringList::const_iterator fb = f.cbegin(), fe = f.cend(), fi;
-
 				_state = FilteredState;
 				_filterResults.clear();
 				if (!_searchInPeer && !f.isEmpty()) {
-					const Dialogs::List *toFilter = nullptr;
-					if (!dialogs->isEmpty()) {
-						for (fi = fb; fi != fe; ++fi) {
-							auto found = dialogs->filtered(fi->at(0));
-							if (found->isEmpty()) {
-								toFilter = nullptr;
-								break;
-							}
-							if (!toFilter || toFilter->size() > found->size()) {
-								toFilter = found;
-							}
-						}
-					}
-					const Dialogs::List *toFilterContacts = nullptr;
-					if (!contactsNoDialogs->isEmpty()) {
-						for (fi = fb; fi != fe; ++fi) {
-							auto found = contactsNoDialogs->filtered(fi->at(0));
-							if (found->isEmpty()) {
-								toFilterContacts = nullptr;
-								break;
-							}
-							if (!toFilterContacts || toFilterContacts->size() > found->size()) {
-								toFilterContacts = found;
-							}
-						}
-					}
-					_filterResults.reserve((toFilter ? toFilter->size() : 0) + (toFilterContacts ? toFilterContacts->size() : 0));
-					if (toFilter) {
-						for_const (auto row, *toFilter) {
-							const PeerData::Names &names(row->history()->peer->names);
-							PeerData::Names::const_iterator nb = names.cbegin(), ne = names.cend(), ni;
-							for (fi = fb; fi != fe; ++fi) {
-								QString filterName(*fi);
-								for (ni = nb; ni != ne; ++ni) {
-									if (ni->startsWith(*fi)) {
-										break;
-									}
-								}
-								if (ni == ne) {
-									break;
-								}
-							}
-							if (fi == fe) {
-								_filterResults.push_back(row);
-							}
-						}
-					}
-					if (toFilterContacts) {
-						for_const (auto row, *toFilterContacts) {
-							const PeerData::Names &names(row->history()->peer->names);
-							PeerData::Names::const_iterator nb = names.cbegin(), ne = names.cend(), ni;
-							for (fi = fb; fi != fe; ++fi) {
-								QString filterName(*fi);
-								for (ni = nb; ni != ne; ++ni) {
-									if (ni->startsWith(*fi)) {
-										break;
-									}
-								}
-								if (ni == ne) {
-									break;
-								}
-							}
-							if (fi == fe) {
-								_filterResults.push_back(row);
-							}
-						}
-					}
+					_filterResults = dialogs->filtered(f);
+					_filterResults.append(contactsNoDialogs->filtered(f));
 				}
 			}
 		}
@@ -923,6 +857,8 @@ void DialogsInner::clearSearchResults(bool clearPeople) {
 		}
 		_searchResults.clear();
 	}
+	_searchResultIds.clear();
+	_searchLocal.clear();
 	_searchedCount = _searchedMigratedCount = 0;
 	_lastSearchDate = 0;
 	_lastSearchPeer = 0;
@@ -964,6 +900,7 @@ void DialogsInner::itemRemoved(HistoryItem *item) {
 	for (int i = 0; i < _searchResults.size();) {
 		if (_searchResults[i]->item() == item) {
 			_searchResults.remove(i);
+			_searchResultIds.remove(item->fullId());
 			if (item->history()->peer == _searchInMigrated) {
 				if (_searchedMigratedCount > 0) --_searchedMigratedCount;
 			} else {
@@ -978,7 +915,7 @@ void DialogsInner::itemRemoved(HistoryItem *item) {
 	}
 }
 
-void DialogsInner::dialogsReceived(const QVector<MTPDialog> &added) {
+void DialogsInner::dialogsReceived(const QVector<MTPDialog> &added, bool fromCache) {
 	for_const (auto &dialog, added) {
 		if (dialog.type() != mtpc_dialog) {
 			continue;
@@ -992,7 +929,8 @@ void DialogsInner::dialogsReceived(const QVector<MTPDialog> &added) {
 
 		auto history = App::historyFromDialog(peerId, d.vunread_count.v, d.vread_inbox_max_id.v, d.vread_outbox_max_id.v);
 		auto peer = history->peer;
-		if (auto channel = peer->asChannel()) {
+		auto channel = fromCache ? nullptr : peer->asChannel();
+		if (channel) {
 			if (d.has_pts()) {
 				channel->ptsReceived(d.vpts.v);
 			}
@@ -1045,14 +983,17 @@ void DialogsInner::addAllSavedPeers() {
 
 bool DialogsInner::searchReceived(const QVector<MTPMessage> &messages, DialogsSearchRequestType type, int32 fullCount) {
 	if (type == DialogsSearchFromStart || type == DialogsSearchPeerFromStart) {
+		auto local = _searchLocal;
 		clearSearchResults(false);
+		_searchLocal = local;
 	}
 	int32 lastDateFound = 0;
 	for (QVector<MTPMessage>::const_iterator i = messages.cbegin(), e = messages.cend(); i != e; ++i) {
 		HistoryItem *item = App::histories().addNewMessage(*i, NewMessageExisting);
 		int32 lastDate = dateFromMessage(*i);
 		if (lastDate) {
-			_searchResults.push_back(new Dialogs::FakeRow(item));
+			addLocalSearchResults(lastDate);
+			addSearchResult(item);
 			lastDateFound = lastDate;
 			if (type == DialogsSearchFromStart || type == DialogsSearchFromOffset) {
 				_lastSearchDate = lastDateFound;
@@ -1070,7 +1011,11 @@ bool DialogsInner::searchReceived(const QVector<MTPMessage> &messages, DialogsSe
 			_lastSearchId = msgId;
 		}
 	}
-	if (type == DialogsSearchMigratedFromStart || type == DialogsSearchMigratedFromOffset) {
+	bool migratedType = (type == DialogsSearchMigratedFromStart || type == DialogsSearchMigratedFromOffset);
+	if (messages.isEmpty() && (migratedType || !_searchInMigrated)) {
+		addLocalSearchResults(0); // the server has nothing older, add all that is left
+	}
+	if (migratedType) {
 		_searchedMigratedCount = fullCount;
 	} else {
 		_searchedCount = fullCount;
@@ -1082,6 +1027,52 @@ bool DialogsInner::searchReceived(const QVector<MTPMessage> &messages, DialogsSe
 	return lastDateFound != 0;
 }
 
+void DialogsInner::localSearchReceived(const QVector<HistoryItem*> &items) {
+	clearSearchResults(false);
+	if (items.isEmpty()) {
+		refresh();
+		return;
+	}
+
+	// Shown until the server results come, then they are merged with those by date,
+	// so the search offsets still come only from the server.
+	_searchResults.reserve(items.size());
+	for_const (auto item, items) {
+		_searchLocal.push_back(item->fullId());
+		addSearchResult(item);
+	}
+	_searchedCount = _searchResults.size();
+	if (_state == FilteredState) {
+		_state = SearchedState;
+	}
+	refresh();
+}
+
+void DialogsInner::addSearchResult(HistoryItem *item) {
+	if (item) {
+		auto id = item->fullId();
+		if (_searchResultIds.contains(id)) {
+			return;
+		}
+		_searchResultIds.insert(id);
+	}
+	_searchResults.push_back(new Dialogs::FakeRow(item));
+}
+
+// Adds the local results newer than upToDate, or all of them if it is zero.
+void DialogsInner::addLocalSearchResults(int32 upToDate) {
+	while (!_searchLocal.isEmpty()) {
+		auto item = App::histItemById(_searchLocal.front());
+		if (item && upToDate && int32(item->date.toTime_t()) <= upToDate) {
+			break;
+		}
+		_searchLocal.pop_front();
+		if (item) {
+			addSearchResult(item);
+		}
+	}
+}
+
 void DialogsInner::peopleReceived(const QString &query, const QVector<MTPPeer> &people) {
 	_peopleQuery = query.toLower().trimmed();
 	_peopleResults.clear();
@@ -1416,11 +1407,14 @@ void DialogsInner::loadPeerPhotos(int32 yFrom) {
 	if (_state == DefaultState) {
 		int32 otherStart = shownDialogs()->size() * st::dialogsRowHeight;
 		if (yFrom < otherStart) {
-			for (auto i = shownDialogs()->cfind(yFrom, st::dialogsRowHeight), end = shownDialogs()->cend(); i != end; ++i) {
-				if (((*i)->pos() * st::dialogsRowHeight) >= yTo) {
-					break;
+			auto i = shownDialogs()->cfind(yFrom, st::dialogsRowHeight), end = shownDialogs()->cend();
+			if (i != end) {
+				for (int32 y = (*i)->pos() * st::dialogsRowHeight; i != end; ++i, y += st::dialogsRowHeight) {
+					if (y >= yTo) {
+						break;
+					}
+					(*i)->history()->peer->loadUserpic();
 				}
-				(*i)->history()->peer->loadUserpic();
 			}
 			yFrom = 0;
 		} else {
@@ -1933,36 +1927,31 @@ void DialogsWidget::dialogsReceived(const MTPmessages_Dialogs &dialogs, mtpReque
 
 	const QVector<MTPDialog> *dialogsList = 0;
 	const QVector<MTPMessage> *messagesList = 0;
+	const MTPVector<MTPChat> *chatsList = 0;
+	const MTPVector<MTPUser> *usersList = 0;
 	switch (dialogs.type()) {
 	case mtpc_messages_dialogs: {
 		const auto &data(dialogs.c_messages_dialogs());
-		App::feedUsers(data.vusers);
-		App::feedChats(data.vchats);
+		usersList = &data.vusers;
+		chatsList = &data.vchats;
 		messagesList = &data.vmessages.c_vector().v;
 		dialogsList = &data.vdialogs.c_vector().v;
 		_dialogsFull = true;
 	} break;
 	case mtpc_messages_dialogsSlice: {
 		const auto &data(dialogs.c_messages_dialogsSlice());
-		App::feedUsers(data.vusers);
-		App::feedChats(data.vchats);
+		usersList = &data.vusers;
+		chatsList = &data.vchats;
 		messagesList = &data.vmessages.c_vector().v;
 		dialogsList = &data.vdialogs.c_vector().v;
 	} break;
 	}
-
-	if (!_contactsRequest) {
-		_contactsRequest = MTP::send(MTPcontacts_GetContacts(MTP_string("")), rpcDone(&DialogsWidget::contactsReceived), rpcFail(&DialogsWidget::contactsFailed));
+	if (usersList) {
+		App::feedUsers(*usersList);
+		App::feedChats(*chatsList);
 	}
 
-	if (messagesList) {
-		App::feedMsgs(*messagesList, NewMessageLast);
-	}
 	if (dialogsList) {
-		unreadCountsReceived(*dialogsList);
-		_inner.dialogsReceived(*dialogsList);
-		onListScroll();
-
 		TimeId lastDate = 0;
 		PeerId lastPeer = 0;
 		MsgId lastMsgId = 0;
@@ -2000,8 +1989,144 @@ void DialogsWidget::dialogsReceived(const MTPmessages_Dialogs &dialogs, mtpReque
 		_dialogsFull = true;
 	}
 
+	// Request the next page right away, so that it is received while this one is applied.
 	_dialogsRequest = 0;
-	loadDialogs();
+	if (!_dialogsFull) {
+		loadDialogs();
+	}
+
+	if (!_contactsRequest) {
+		_contactsRequest = MTP::send(MTPcontacts_GetContacts(MTP_string("")), rpcDone(&DialogsWidget::contactsReceived), rpcFail(&DialogsWidget::contactsFailed));
+	}
+
+	if (dialogsList && !_dialogsCacheMessages.isEmpty()) {
+		// The cached last message is not the actual one any more, it could be deleted
+		// and it would be followed by the actual one without the messages in between.
+		for_const (auto &dialog, *dialogsList) {
+			if (dialog.type() != mtpc_dialog) {
+				continue;
+			}
+			auto &d = dialog.c_dialog();
+			auto i = _dialogsCacheMessages.find(peerFromMTP(d.vpeer));
+			if (i != _dialogsCacheMessages.cend()) {
+				if (i.value() != d.vtop_message.v) {
+					destroyCachedMessage(i.key(), i.value());
+				}
+				_dialogsCacheMessages.erase(i);
+			}
+		}
+	}
+	if (messagesList) {
+		App::feedMsgs(*messagesList, NewMessageLast);
+	}
+	if (dialogsList) {
+		if (!_dialogsCachePeers.isEmpty()) {
+			for_const (auto &dialog, *dialogsList) {
+				if (dialog.type() != mtpc_dialog) {
+					continue;
+				}
+				auto peerId = peerFromMTP(dialog.c_dialog().vpeer);
+				if (_dialogsCachePeers.remove(peerId)) {
+					// The cached unread count could be bigger than the actual one.
+					if (auto history = App::historyLoaded(peerId)) {
+						history->setUnreadCount(0);
+					}
+				}
+			}
+		}
+		dialogsCacheAdd(*dialogsList, *messagesList, *chatsList, *usersList);
+
+		unreadCountsReceived(*dialogsList);
+		_inner.dialogsReceived(*dialogsList);
+		onListScroll();
+	}
+
+	if (_dialogsFull) {
+		loadDialogs();
+	}
+}
+
+void DialogsWidget::showDialogsCache() {
+	MTPmessages_Dialogs cached;
+	if (!Local::readDialogsCache(cached) || cached.type() != mtpc_messages_dialogs) {
+		return;
+	}
+
+	auto &d = cached.c_messages_dialogs();
+	App::feedCachedUsers(d.vusers);
+	App::feedCachedChats(d.vchats);
+
+	// Remember the messages that are created from the cache, they are destroyed
+	// if the server does not return them as the last messages of the dialogs.
+	auto &messagesList = d.vmessages.c_vector().v;
+	QMap<PeerId, MsgId> created;
+	for_const (auto &message, messagesList) {
+		auto peerId = peerFromMessage(message);
+		auto msgId = idFromMessage(message);
+		if (peerId && msgId > 0 && !App::histItemById(peerToChannel(peerId), msgId)) {
+			created.insert(peerId, msgId);
+		}
+	}
+	App::feedMsgs(d.vmessages, NewMessageLast);
+	for (auto i = created.cbegin(), e = created.cend(); i != e; ++i) {
+		if (auto item = App::histItemById(peerToChannel(i.key()), i.value())) {
+			item->setFromLocalCache(true);
+			_dialogsCacheMessages.insert(i.key(), i.value());
+		}
+	}
+
+	auto &dialogsList = d.vdialogs.c_vector().v;
+	for_const (auto &dialog, dialogsList) {
+		if (dialog.type() == mtpc_dialog) {
+			if (auto peerId = peerFromMTP(dialog.c_dialog().vpeer)) {
+				_dialogsCachePeers.insert(peerId);
+			}
+		}
+	}
+	_inner.dialogsReceived(dialogsList, true);
+	_inner.loadPeerPhotos(_scroll.scrollTop());
+}
+
+void DialogsWidget::dialogsCacheAdd(const QVector<MTPDialog> &dialogs, const QVector<MTPMessage> &messages, const MTPVector<MTPChat> &chats, const MTPVector<MTPUser> &users) {
+	if (!_dialogsCacheData || _dialogsCacheData->dialogs.size() >= DialogsCacheLimit) {
+		return;
+	}
+	_dialogsCacheData->dialogs += dialogs;
+	_dialogsCacheData->messages += messages;
+	_dialogsCacheData->chats += chats.c_vector().v;
+	_dialogsCacheData->users += users.c_vector().v;
+}
+
+void DialogsWidget::dialogsCacheLoaded() {
+	// Cached dialogs not received from the server were deleted or left.
+	for_const (auto peerId, _dialogsCachePeers) {
+		if (auto history = App::historyLoaded(peerId)) {
+			if (!cSavedPeers().contains(history->peer)) {
+				history->setUnreadCount(0);
+				_inner.removeDialog(history);
+			}
+		}
+	}
+	_dialogsCachePeers.clear();
+
+	for (auto i = _dialogsCacheMessages.cbegin(), e = _dialogsCacheMessages.cend(); i != e; ++i) {
+		destroyCachedMessage(i.key(), i.value());
+	}
+	_dialogsCacheMessages.clear();
+
+	if (_dialogsCacheData) {
+		auto &data = *_dialogsCacheData;
+		Local::writeDialogsCache(MTP_messages_dialogs(MTP_vector<MTPDialog>(data.dialogs), MTP_vector<MTPMessage>(data.messages), MTP_vector<MTPChat>(data.chats), MTP_vector<MTPUser>(data.users)));
+		_dialogsCacheData = nullptr;
+	}
+}
+
+void DialogsWidget::destroyCachedMessage(PeerId peerId, MsgId msgId) {
+	// If the message was received again since, it is not a cached message any more.
+	auto item = App::histItemById(peerToChannel(peerId), msgId);
+	if (item && item->fromLocalCache()) {
+		item->destroy();
+	}
 }
 
 bool DialogsWidget::dialogsFailed(const RPCError &error, mtpRequestId req) {
@@ -2052,6 +2177,9 @@ bool DialogsWidget::onSearchMessages(bool searchCache) {
 			_searchRequest = MTP::send(MTPmessages_SearchGlobal(MTP_string(_searchQuery), MTP_int(0), MTP_inputPeerEmpty(), MTP_int(0), MTP_int(SearchPerPage)), rpcDone(&DialogsWidget::searchReceived, DialogsSearchFromStart), rpcFail(&DialogsWidget::searchFailed, DialogsSearchFromStart));
 		}
 		_searchQueries.insert(_searchRequest, _searchQuery);
+
+		// Show the loaded messages found locally while the server results are requested.
+		_inner.localSearchReceived(App::historySearchLoaded(_searchQuery, _searchInPeer, _searchInMigrated, SearchPerPage));
 	}
 	if (!_searchInPeer && q.size() >= MinUsernameLength) {
 		if (searchCache) {
@@ -2126,11 +2254,18 @@ void DialogsWidget::onSearchMore() {
 void DialogsWidget::loadDialogs() {
 	if (_dialogsRequest) return;
 	if (_dialogsFull) {
+		if (!cDialogsReceived()) {
+			dialogsCacheLoaded();
+		}
 		_inner.addAllSavedPeers();
 		cSetDialogsReceived(true);
 		return;
 	}
 
+	if (!_dialogsOffsetDate && !_dialogsCacheData) {
+		_dialogsCacheData = std_::make_unique<DialogsCacheData>();
+	}
+
 	int32 loadCount = _dialogsOffsetDate ? DialogsPerPage : DialogsFirstLoad;
 	_dialogsRequest = MTP::send(MTPmessages_GetDialogs(MTP_int(_dialogsOffsetDate), MTP_int(_dialogsOffsetId), _dialogsOffsetPeer ? _dialogsOffsetPeer->input : MTP_inputPeerEmpty(), MTP_int(loadCount)), rpcDone(&DialogsWidget::dialogsReceived), rpcFail(&DialogsWidget::dialogsFailed));
 }
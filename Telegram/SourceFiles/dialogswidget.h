@@ -49,10 +49,13 @@ public:
 
 	DialogsInner(QWidget *parent, MainWidget *main);
 
-	void dialogsReceived(const QVector<MTPDialog> &dialogs);
+	// Dialogs from the local cache are shown before the server ones
+	// are received, so we don't update the channels pts by them.
+	void dialogsReceived(const QVector<MTPDialog> &dialogs, bool fromCache = false);
 	void addSavedPeersAfter(const QDateTime &date);
 	void addAllSavedPeers();
 	bool searchReceived(const QVector<MTPMessage> &messages, DialogsSearchRequestType type, int32 fullCount);
+	void localSearchReceived(const QVector<HistoryItem*> &items);
 	void peopleReceived(const QString &query, const QVector<MTPPeer> &people);
 	void showMore(int32 pixels);
 
@@ -175,6 +178,8 @@ private:
 
 	void clearSelection();
 	void clearSearchResults(bool clearPeople = true);
+	void addSearchResult(HistoryItem *item);
+	void addLocalSearchResults(int32 upToDate);
 	void updateSelectedRow(PeerData *peer = 0);
 	bool menuPeerMuted();
 	void contextBlockDone(QPair<UserData*, bool> data, const MTPBool &result);
@@ -203,6 +208,8 @@ private:
 	int _filteredSel = -1;
 
 	SearchResults _searchResults;
+	OrderedSet<FullMsgId> _searchResultIds;
+	QList<FullMsgId> _searchLocal; // found locally and not yet merged with the server results, newest first
 	int _searchedCount = 0;
 	int _searchedMigratedCount = 0;
 	int _searchedSel = -1;
@@ -260,6 +267,7 @@ public:
 	void searchInPeer(PeerData *peer);
 
 	void loadDialogs();
+	void showDialogsCache();
 	void createDialog(History *history);
 	void dlgUpdated(Dialogs::Mode list, Dialogs::Row *row);
 	void dlgUpdated(History *row, MsgId msgId);
@@ -328,6 +336,9 @@ private:
 	QTimer _chooseByDragTimer;
 
 	void unreadCountsReceived(const QVector<MTPDialog> &dialogs);
+	void dialogsCacheAdd(const QVector<MTPDialog> &dialogs, const QVector<MTPMessage> &messages, const MTPVector<MTPChat> &chats, const MTPVector<MTPUser> &users);
+	void dialogsCacheLoaded();
+	void destroyCachedMessage(PeerId peerId, MsgId msgId);
 	bool dialogsFailed(const RPCError &error, mtpRequestId req);
 	bool contactsFailed(const RPCError &error);
 	bool searchFailed(DialogsSearchRequestType type, const RPCError &error, mtpRequestId req);
@@ -339,6 +350,21 @@ private:
 	PeerData *_dialogsOffsetPeer;
 	mtpRequestId _dialogsRequest, _contactsRequest;
 
+	// Dialogs shown from the local cache and not received from the server yet.
+	OrderedSet<PeerId> _dialogsCachePeers;
+
+	// Last messages created from the local cache and not confirmed by the server yet.
+	QMap<PeerId, MsgId> _dialogsCacheMessages;
+
+	// Received dialogs pages, written to the local cache when all are received.
+	struct DialogsCacheData {
+		QVector<MTPDialog> dialogs;
+		QVector<MTPMessage> messages;
+		QVector<MTPChat> chats;
+		QVector<MTPUser> users;
+	};
+	std_::unique_ptr<DialogsCacheData> _dialogsCacheData;
+
 	FlatInput _filter;
 	ChildWidget<Ui::RoundButton> _newGroup;
 	IconedButton _addContact, _cancelSearch;
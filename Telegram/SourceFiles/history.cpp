@@ -706,6 +706,7 @@ HistoryItem *History::createItem(const MTPMessage &msg, bool applyServiceAction,
 
 	HistoryItem *result = App::histItemById(channelId(), msgId);
 	if (result) {
+		result->setFromLocalCache(false);
 		if (!result->detached() && detachExistingItem) {
 			result->detach();
 		}
@@ -996,20 +997,54 @@ HistoryItem *History::addNewPhoto(MsgId id, MTPDmessage::Flags flags, int32 viaB
 	return addNewItem(createItemPhoto(id, flags, viaBotId, replyTo, date, from, photo, caption, markup), true);
 }
 
-bool History::addToOverview(MediaOverviewType type, MsgId msgId, AddToOverviewMethod method) {
-	bool adding = false;
-	switch (method) {
-	case AddToOverviewNew:
-	case AddToOverviewFront: adding = (overviewIds[type].constFind(msgId) == overviewIds[type].cend()); break;
-	case AddToOverviewBack: adding = (overviewCountData[type] != 0); break;
+int HistoryMediaOverview::indexOf(MsgId msgId) const {
+	auto i = std::lower_bound(_ids.cbegin(), _ids.cend(), msgId, &HistoryMediaOverview::less);
+	return (i != _ids.cend() && *i == msgId) ? static_cast<int>(i - _ids.cbegin()) : -1;
+}
+
+bool HistoryMediaOverview::insert(MsgId msgId) {
+	if (_ids.empty() || less(_ids.back(), msgId)) {
+		_ids.push_back(msgId);
+		return true;
+	} else if (less(msgId, _ids.front())) {
+		_ids.push_front(msgId);
+		return true;
+	}
+	auto i = std::lower_bound(_ids.begin(), _ids.end(), msgId, &HistoryMediaOverview::less);
+	if (*i == msgId) {
+		return false;
+	}
+	_ids.insert(i, msgId);
+	return true;
+}
+
+bool HistoryMediaOverview::remove(MsgId msgId) {
+	auto i = std::lower_bound(_ids.begin(), _ids.end(), msgId, &HistoryMediaOverview::less);
+	if (i == _ids.end() || *i != msgId) {
+		return false;
 	}
-	if (!adding) return false;
+	_ids.erase(i);
+	return true;
+}
+
+MsgId HistoryMediaOverview::minServerId() const {
+	return (!_ids.empty() && _ids.front() > 0) ? _ids.front() : 0;
+}
 
-	overviewIds[type].insert(msgId, NullType());
-	switch (method) {
-	case AddToOverviewNew:
-	case AddToOverviewBack: overview[type].push_back(msgId); break;
-	case AddToOverviewFront: overview[type].push_front(msgId); break;
+int HistoryMediaOverview::localCount() const {
+	int result = 0;
+	for (auto i = _ids.crbegin(), e = _ids.crend(); i != e && *i < 0; ++i) {
+		++result;
+	}
+	return result;
+}
+
+bool History::addToOverview(MediaOverviewType type, MsgId msgId, AddToOverviewMethod method) {
+	if (method == AddToOverviewBack && !overviewCountData[type]) {
+		return false;
+	}
+	if (!overview[type].insert(msgId)) {
+		return false;
 	}
 	if (method == AddToOverviewNew) {
 		if (overviewCountData[type] > 0) {
@@ -1021,20 +1056,10 @@ bool History::addToOverview(MediaOverviewType type, MsgId msgId, AddToOverviewMe
 }
 
 void History::eraseFromOverview(MediaOverviewType type, MsgId msgId) {
-	if (overviewIds[type].isEmpty()) return;
+	if (!overview[type].remove(msgId)) return;
 
-	History::MediaOverviewIds::iterator i = overviewIds[type].find(msgId);
-	if (i == overviewIds[type].cend()) return;
-
-	overviewIds[type].erase(i);
-	for (History::MediaOverview::iterator i = overview[type].begin(), e = overview[type].end(); i != e; ++i) {
-		if ((*i) == msgId) {
-			overview[type].erase(i);
-			if (overviewCountData[type] > 0) {
-				--overviewCountData[type];
-			}
-			break;
-		}
+	if (overviewCountData[type] > 0) {
+		--overviewCountData[type];
 	}
 	if (App::wnd()) App::wnd()->mediaOverviewUpdated(peer, type);
 }
@@ -1206,6 +1231,23 @@ void History::addItemToBlock(HistoryItem *item) {
 	}
 }
 
+QVector<HistoryItem*> History::createItems(const QVector<MTPMessage> &data) {
+	QVector<HistoryItem*> result;
+	if (data.isEmpty()) {
+		return result;
+	}
+
+	result.reserve(data.size());
+	App::historyReserveItems(data.size());
+	for (auto i = data.cend(), e = data.cbegin(); i != e;) {
+		--i;
+		if (auto adding = createItem(*i, false, true)) {
+			result.push_back(adding);
+		}
+	}
+	return result;
+}
+
 void History::addOlderSlice(const QVector<MTPMessage> &slice) {
 	if (slice.isEmpty()) {
 		oldLoaded = true;
@@ -1216,17 +1258,17 @@ void History::addOlderSlice(const QVector<MTPMessage> &slice) {
 		return;
 	}
 
-	startBuildingFrontBlock(slice.size());
-
-	for (auto i = slice.cend(), e = slice.cbegin(); i != e;) {
-		--i;
-		HistoryItem *adding = createItem(*i, false, true);
-		if (!adding) continue;
-
-		addItemToBlock(adding);
+	auto items = createItems(slice);
+	HistoryBlock *block = nullptr;
+	if (!items.isEmpty()) {
+		startBuildingFrontBlock(items.size());
+		for_const (auto adding, items) {
+			if (adding->detached()) { // could be already added if the slice had the same id twice
+				addItemToBlock(adding);
+			}
+		}
+		block = finishBuildingFrontBlock();
 	}
-
-	HistoryBlock *block = finishBuildingFrontBlock();
 	if (!block) {
 		// If no items were added it means we've loaded everything old.
 		oldLoaded = true;
@@ -1326,14 +1368,14 @@ void History::addNewerSlice(const QVector<MTPMessage> &slice) {
 
 	t_assert(!isBuildingFrontBlock());
 	if (!slice.isEmpty()) {
+		auto items = createItems(slice);
+		blocks.reserve(blocks.size() + (items.size() / MessagesPerPage) + 1);
 		bool atLeastOneAdded = false;
-		for (auto i = slice.cend(), e = slice.cbegin(); i != e;) {
-			--i;
-			HistoryItem *adding = createItem(*i, false, true);
-			if (!adding) continue;
-
-			addItemToBlock(adding);
-			atLeastOneAdded = true;
+		for_const (auto adding, items) {
+			if (adding->detached()) { // could be already added if the slice had the same id twice
+				addItemToBlock(adding);
+				atLeastOneAdded = true;
+			}
 		}
 
 		if (!atLeastOneAdded) {
@@ -1346,9 +1388,8 @@ void History::addNewerSlice(const QVector<MTPMessage> &slice) {
 		int32 mask = 0;
 		for (int32 i = 0; i < OverviewCount; ++i) {
 			if (overviewCountData[i] == 0) continue; // all loaded
-			if (!overview[i].isEmpty() || !overviewIds[i].isEmpty()) {
+			if (!overview[i].isEmpty()) {
 				overview[i].clear();
-				overviewIds[i].clear();
 				mask |= (1 << i);
 			}
 		}
@@ -1754,6 +1795,130 @@ void History::setNotLoadedAtBottom() {
 	newLoaded = false;
 }
 
+void History::unloadOlderBlocks(int count) {
+	HistoryItem *visible[] = { scrollTopItem, showFrom, unreadBar };
+	for_const (auto item, visible) {
+		if (item && !item->detached()) {
+			accumulate_min(count, item->block()->indexInHistory());
+		}
+	}
+	if (count <= 0 || count >= blocks.size()) return;
+
+	unloadBlocks(0, count);
+	oldLoaded = false;
+	blocks.front()->items.front()->previousItemChanged();
+}
+
+void History::unloadNewerBlocks(int count) {
+	HistoryItem *visible[] = { scrollTopItem, showFrom, unreadBar };
+	for_const (auto item, visible) {
+		if (item && !item->detached()) {
+			accumulate_min(count, blocks.size() - 1 - item->block()->indexInHistory());
+		}
+	}
+	if (count <= 0 || count >= blocks.size()) return;
+
+	unloadBlocks(blocks.size() - count, blocks.size());
+	newLoaded = false;
+}
+
+void History::unloadBlocks(int from, int till) {
+	Blocks unloaded;
+	unloaded.reserve(till - from);
+	for (int i = from; i < till; ++i) {
+		unloaded.push_back(blocks.at(i));
+	}
+	blocks.erase(blocks.begin() + from, blocks.begin() + till);
+	for (int i = from, l = blocks.size(); i < l; ++i) {
+		blocks.at(i)->setIndexInHistory(i);
+	}
+
+	for_const (auto block, unloaded) {
+		if (_buildingFrontBlock && block == _buildingFrontBlock->block) {
+			_buildingFrontBlock->block = nullptr;
+		}
+
+		HistoryBlock::Items items;
+		std::swap(items, block->items);
+		for_const (auto item, items) {
+			if (lastSentMsg == item) {
+				lastSentMsg = nullptr;
+			}
+			if (isChannel()) {
+				asChannelHistory()->messageDetached(item);
+			}
+			item->detachFast();
+			if (canUnloadItem(item)) {
+				Global::RefPendingRepaintItems().remove(item);
+				delete item;
+			} else {
+				App::historyItemDetached(item);
+				if (item->id > 0) {
+					_retainedItems.insert(item->id);
+				}
+			}
+		}
+		delete block;
+	}
+	setHasPendingResizedItems();
+}
+
+// Items that are still referenced stay in memory detached from the blocks: they don't
+// take part in the layout any more, but they are not freed either. This includes every
+// message loaded to a media overview (the overview widgets look the items up by id) and
+// every message some reply refers to. They are freed by releaseRetainedItems() later.
+bool History::canUnloadItem(const HistoryItem *item) const {
+	if (item->id <= 0 || item == lastMsg || item->id == lastKeyboardId) {
+		return false;
+	}
+	if (peer->isMegagroup() && peer->asChannel()->mgInfo->pinnedMsgId == item->id) {
+		return false;
+	}
+	if (notifies.contains(const_cast<HistoryItem*>(item))) {
+		return false;
+	}
+	for (int32 i = 0; i < OverviewCount; ++i) {
+		if (overviewHasMsgId(i, item->id)) {
+			return false;
+		}
+	}
+	return !App::historyHasDependentItems(item);
+}
+
+void History::releaseRetainedItems() {
+	if (_retainedItems.isEmpty()) return;
+
+	// The shown media overview or media viewer look the overview items up by id.
+	if (App::main() && App::main()->overviewPeer() == peer) return;
+	if (App::wnd() && App::wnd()->ui_isMediaViewShown()) return;
+
+	// The overview lists are loaded again when the overview is opened, like after clear(true).
+	for (int32 i = 0; i < OverviewCount; ++i) {
+		if (!overview[i].isEmpty()) {
+			if (overviewCountData[i] == 0) {
+				overviewCountData[i] = overview[i].size();
+			}
+			overview[i].clear();
+			if (App::wnd() && !App::quitting()) App::wnd()->mediaOverviewUpdated(peer, MediaOverviewType(i));
+		}
+	}
+
+	OrderedSet<MsgId> retained;
+	std::swap(retained, _retainedItems);
+	for_const (auto msgId, retained) {
+		auto item = App::histItemById(channelId(), msgId);
+		if (!item || !item->detached()) {
+			continue;
+		}
+		if (canUnloadItem(item)) {
+			Global::RefPendingRepaintItems().remove(item);
+			delete item;
+		} else {
+			_retainedItems.insert(msgId);
+		}
+	}
+}
+
 namespace {
 	uint32 _dialogsPosToTopShift = 0x80000000UL;
 }
@@ -1851,7 +2016,80 @@ MsgId History::msgIdForRead() const {
 	return result;
 }
 
+namespace {
+
+// Resizing less items than that is faster without the thread pool round trip.
+constexpr int ParallelResizeItemsMin = 256;
+constexpr int ParallelResizeWaitMs = 100;
+
+QThreadPool *ResizeThreadPool() {
+	static QThreadPool *pool = nullptr;
+	if (!pool) {
+		pool = new QThreadPool(App::app());
+		pool->setMaxThreadCount(qMax(QThread::idealThreadCount(), 1));
+	}
+	return pool;
+}
+
+struct PrepareResizeState {
+	QSemaphore done;
+	QAtomicInt cancelled;
+};
+
+class PrepareResizeTask : public QRunnable {
+public:
+	PrepareResizeTask(const HistoryItem * const *from, const HistoryItem * const *till, int width, PrepareResizeState *state)
+	: _from(from)
+	, _till(till)
+	, _width(width)
+	, _state(state) {
+	}
+	void run() override {
+		for (auto i = _from; i != _till && !_state->cancelled.loadAcquire(); ++i) {
+			(*i)->prepareResize(_width);
+		}
+		_state->done.release();
+	}
+
+private:
+	const HistoryItem * const *_from;
+	const HistoryItem * const *_till;
+	int _width;
+	PrepareResizeState *_state;
+
+};
+
+// Text measuring only reads the font metrics and the text style passed
+// explicitly, so it is done for all the items in parallel and the results are
+// left in the Text layout caches. The GUI thread waits for the tasks at most
+// ParallelResizeWaitMs, then stops them after their current items and resizes
+// the items as usual, measuring the ones that were not prepared by itself.
+void prepareItemsResize(const QVector<const HistoryItem*> &items, int width) {
+	int threads = QThread::idealThreadCount();
+	if (threads < 2 || items.size() < ParallelResizeItemsMin) {
+		return;
+	}
+
+	auto pool = ResizeThreadPool();
+	int tasks = qMin(threads * 4, items.size() / (ParallelResizeItemsMin / 4));
+	int perTask = (items.size() + tasks - 1) / tasks;
+	PrepareResizeState state;
+	int started = 0;
+	for (auto from = items.constData(), end = from + items.size(); from != end; ++started) {
+		auto till = (end - from > perTask) ? (from + perTask) : end;
+		pool->start(new PrepareResizeTask(from, till, width, &state));
+		from = till;
+	}
+	if (!state.done.tryAcquire(started, ParallelResizeWaitMs)) {
+		state.cancelled.storeRelease(1);
+		state.done.acquire(started);
+	}
+}
+
+} // namespace
+
 int History::resizeGetHeight(int newWidth) {
+	TRACE_SCOPE("History::resizeGetHeight");
 	bool resizeAllItems = (_flags & Flag::f_pending_resize) || (width != newWidth);
 
 	if (!resizeAllItems && !hasPendingResizedItems()) {
@@ -1859,6 +2097,16 @@ int History::resizeGetHeight(int newWidth) {
 	}
 	_flags &= ~(Flag::f_pending_resize | Flag::f_has_pending_resized_items);
 
+	if (resizeAllItems && QThread::idealThreadCount() > 1) {
+		QVector<const HistoryItem*> items;
+		for_const (HistoryBlock *block, blocks) {
+			for_const (HistoryItem *item, block->items) {
+				items.push_back(item);
+			}
+		}
+		prepareItemsResize(items, newWidth);
+	}
+
 	width = newWidth;
 	int y = 0;
 	for_const (HistoryBlock *block, blocks) {
@@ -1907,7 +2155,7 @@ void History::clear(bool leaveItems) {
 		}
 	}
 	for (int32 i = 0; i < OverviewCount; ++i) {
-		if (!overview[i].isEmpty() || !overviewIds[i].isEmpty()) {
+		if (!overview[i].isEmpty()) {
 			if (leaveItems) {
 				if (overviewCountData[i] == 0) {
 					overviewCountData[i] = overview[i].size();
@@ -1916,7 +2164,6 @@ void History::clear(bool leaveItems) {
 				overviewCountData[i] = -1; // not loaded yet
 			}
 			overview[i].clear();
-			overviewIds[i].clear();
 			if (App::wnd() && !App::quitting()) App::wnd()->mediaOverviewUpdated(peer, MediaOverviewType(i));
 		}
 	}
@@ -2062,40 +2309,20 @@ void History::overviewSliceDone(int32 overviewIndex, const MTPmessages_Messages
 	if (!onlyCounts && v->isEmpty()) {
 		overviewCountData[overviewIndex] = 0;
 	} else if (overviewCountData[overviewIndex] > 0) {
-		for (History::MediaOverviewIds::const_iterator i = overviewIds[overviewIndex].cbegin(), e = overviewIds[overviewIndex].cend(); i != e; ++i) {
-			if (i.key() < 0) {
-				++overviewCountData[overviewIndex];
-			} else {
-				break;
-			}
-		}
+		overviewCountData[overviewIndex] += overview[overviewIndex].localCount();
 	}
 
 	for (QVector<MTPMessage>::const_iterator i = v->cbegin(), e = v->cend(); i != e; ++i) {
-		HistoryItem *item = App::histories().addNewMessage(*i, NewMessageExisting);
-		if (item && overviewIds[overviewIndex].constFind(item->id) == overviewIds[overviewIndex].cend()) {
-			overviewIds[overviewIndex].insert(item->id, NullType());
-			overview[overviewIndex].push_front(item->id);
+		if (HistoryItem *item = App::histories().addNewMessage(*i, NewMessageExisting)) {
+			overview[overviewIndex].insert(item->id);
 		}
 	}
 }
 
 void History::changeMsgId(MsgId oldId, MsgId newId) {
 	for (int32 i = 0; i < OverviewCount; ++i) {
-		History::MediaOverviewIds::iterator j = overviewIds[i].find(oldId);
-		if (j != overviewIds[i].cend()) {
-			overviewIds[i].erase(j);
-			int32 index = overview[i].indexOf(oldId);
-			if (overviewIds[i].constFind(newId) == overviewIds[i].cend()) {
-				overviewIds[i].insert(newId, NullType());
-				if (index >= 0) {
-					overview[i][index] = newId;
-				} else {
-					overview[i].push_back(newId);
-				}
-			} else if (index >= 0) {
-				overview[i].removeAt(index);
-			}
+		if (overview[i].remove(oldId)) {
+			overview[i].insert(newId);
 		}
 	}
 }
@@ -2688,6 +2915,7 @@ void HistoryItem::finishCreate() {
 
 void HistoryItem::finishEdition(int oldKeyboardTop) {
 	setPendingInitDimensions();
+	App::historyReindexItemText(this);
 	if (App::main()) {
 		App::main()->dlgUpdated(history(), id);
 	}
@@ -7561,15 +7789,32 @@ int HistoryMessage::resizeGetHeight_(int width) {
 	return result;
 }
 
-int HistoryMessage::performResizeGetHeight(int width) {
-	if (width < st::msgMinWidth) return _height;
-
+int HistoryMessage::countTextWidth(int width) const {
 	width -= st::msgMargin.left() + st::msgMargin.right();
 	if (width < st::msgPadding.left() + st::msgPadding.right() + 1) {
 		width = st::msgPadding.left() + st::msgPadding.right() + 1;
 	} else if (width > st::msgMaxWidth) {
 		width = st::msgMaxWidth;
 	}
+	return width;
+}
+
+void HistoryMessage::prepareResize_(int width) const {
+	if (width < st::msgMinWidth || !drawBubble() || _text.isEmpty()) return;
+
+	width = countTextWidth(width);
+	if (width < _maxw) {
+		int32 textWidth = qMax(width - st::msgPadding.left() - st::msgPadding.right(), 1);
+		if (textWidth != _textWidth) {
+			_text.countHeight(textWidth, textStyle());
+		}
+	}
+}
+
+int HistoryMessage::performResizeGetHeight(int width) {
+	if (width < st::msgMinWidth) return _height;
+
+	width = countTextWidth(width);
 	if (drawBubble()) {
 		auto fwd = Get<HistoryMessageForwarded>();
 		auto reply = Get<HistoryMessageReply>();
@@ -7585,10 +7830,8 @@ int HistoryMessage::performResizeGetHeight(int width) {
 			} else {
 				int32 textWidth = qMax(width - st::msgPadding.left() - st::msgPadding.right(), 1);
 				if (textWidth != _textWidth) {
-					textstyleSet(&((out() && !isPost()) ? st::outTextStyle : st::inTextStyle));
 					_textWidth = textWidth;
-					_textHeight = _text.countHeight(textWidth);
-					textstyleRestore();
+					_textHeight = _text.countHeight(textWidth, textStyle());
 				}
 				_height = st::msgPadding.top() + _textHeight + st::msgPadding.bottom();
 			}
@@ -29,6 +29,8 @@ typedef QMap<int32, HistoryItem*> SelectedItemSet;
 #include "structs.h"
 #include "dialogs/dialogs_common.h"
 
+#include <deque>
+
 enum NewMessageType {
 	NewMessageUnread,
 	NewMessageLast,
@@ -173,6 +175,50 @@ class Row;
 class IndexedList;
 } // namespace Dialogs
 
+// Message ids of one media overview type in chronological order: server ids
+// ascending and then the local ids of the messages that are still being sent.
+// It is a sorted std::deque, so lookups are O(log(n)) and adding older or newer
+// slices to either end does not move the others. An insert in the middle moves
+// the ids on the nearer side, but the only such inserts are sent messages that
+// get their server ids just before the few local ones at the end.
+class HistoryMediaOverview {
+public:
+	int size() const {
+		return static_cast<int>(_ids.size());
+	}
+	bool isEmpty() const {
+		return _ids.empty();
+	}
+	MsgId at(int index) const {
+		return _ids[index];
+	}
+	MsgId operator[](int index) const {
+		return _ids[index];
+	}
+
+	bool contains(MsgId msgId) const {
+		return indexOf(msgId) >= 0;
+	}
+	int indexOf(MsgId msgId) const; // -1 if not found
+	bool insert(MsgId msgId); // false if it was already there
+	bool remove(MsgId msgId); // false if it was not found
+	void clear() {
+		_ids.clear();
+	}
+
+	MsgId minServerId() const; // 0 if there are no server ids
+	int localCount() const; // count of not yet sent messages
+
+private:
+	// Local ids are negative, so they go after all the server ids as unsigned.
+	static bool less(MsgId a, MsgId b) {
+		return uint32(a) < uint32(b);
+	}
+
+	std::deque<MsgId> _ids;
+
+};
+
 class ChannelHistory;
 class History {
 public:
@@ -241,6 +287,18 @@ public:
 
 	bool loadedAtBottom() const; // last message is in the list
 	void setNotLoadedAtBottom();
+
+	// Unload blocks far from the visible area so that scrolling through a long
+	// history keeps bounded memory, they are loaded again by the usual preloading.
+	// Items still referenced from somewhere (last message, overview, replies)
+	// are only detached, all the others are destroyed.
+	void unloadOlderBlocks(int count);
+	void unloadNewerBlocks(int count);
+
+	// Destroys the detached items nothing refers to any more. The media overview
+	// lists are dropped for that if neither overview nor media viewer is shown.
+	void releaseRetainedItems();
+
 	bool loadedAtTop() const; // nothing was added after loading history back
 	bool isReadyFor(MsgId msgId); // has messages for showing history at msgId
 	void getReadyFor(MsgId msgId);
@@ -413,7 +471,7 @@ public:
 	uint32 typingDots;
 	QMap<SendActionType, uint64> mySendActions;
 
-	typedef QList<MsgId> MediaOverview;
+	typedef HistoryMediaOverview MediaOverview;
 	MediaOverview overview[OverviewCount];
 
 	bool overviewCountLoaded(int32 overviewIndex) const {
@@ -434,16 +492,11 @@ public:
 		return result;
 	}
 	MsgId overviewMinId(int32 overviewIndex) const {
-		for (MediaOverviewIds::const_iterator i = overviewIds[overviewIndex].cbegin(), e = overviewIds[overviewIndex].cend(); i != e; ++i) {
-			if (i.key() > 0) {
-				return i.key();
-			}
-		}
-		return 0;
+		return overview[overviewIndex].minServerId();
 	}
 	void overviewSliceDone(int32 overviewIndex, const MTPmessages_Messages &result, bool onlyCounts = false);
 	bool overviewHasMsgId(int32 overviewIndex, MsgId msgId) const {
-		return overviewIds[overviewIndex].constFind(msgId) != overviewIds[overviewIndex].cend();
+		return overview[overviewIndex].contains(msgId);
 	}
 
 	void changeMsgId(MsgId oldId, MsgId newId);
@@ -464,7 +517,17 @@ protected:
 
 	void clearBlocks(bool leaveItems);
 
+	void unloadBlocks(int from, int till);
+	bool canUnloadItem(const HistoryItem *item) const;
+
+	// Ids of the unloaded items that were kept because something referred to them.
+	OrderedSet<MsgId> _retainedItems;
+
 	HistoryItem *createItem(const MTPMessage &msg, bool applyServiceAction, bool detachExistingItem);
+
+	// Creates all the items of a slice, oldest first. The registry is reserved for
+	// the whole slice once, the items are still registered one by one when created.
+	QVector<HistoryItem*> createItems(const QVector<MTPMessage> &data);
 	HistoryItem *createItemForwarded(MsgId id, MTPDmessage::Flags flags, QDateTime date, int32 from, HistoryMessage *msg);
 	HistoryItem *createItemDocument(MsgId id, MTPDmessage::Flags flags, int32 viaBotId, MsgId replyTo, QDateTime date, int32 from, DocumentData *doc, const QString &caption, const MTPReplyMarkup &markup);
 	HistoryItem *createItemPhoto(MsgId id, MTPDmessage::Flags flags, int32 viaBotId, MsgId replyTo, QDateTime date, int32 from, PhotoData *photo, const QString &caption, const MTPReplyMarkup &markup);
@@ -526,8 +589,6 @@ private:
 	}
 	uint64 _sortKeyInChatList = 0; // like ((unixtime) << 32) | (incremented counter)
 
-	typedef QMap<MsgId, NullType> MediaOverviewIds;
-	MediaOverviewIds overviewIds[OverviewCount];
 	int32 overviewCountData[OverviewCount]; // -1 - not loaded, 0 - all loaded, > 0 - count, but not all loaded
 
 	// A pointer to the block that is currently being built.
@@ -1040,6 +1101,15 @@ public:
 		}
 		return resizeGetHeight_(width);
 	}
+
+	// Called from a worker thread before resizeGetHeight() when many items
+	// are resized at once, it should only measure the item texts for the
+	// new width so that the following resizeGetHeight() finds them cached.
+	void prepareResize(int width) const {
+		if (!(_flags & MTPDmessage_ClientFlag::f_pending_init_dimensions)) {
+			prepareResize_(width);
+		}
+	}
 	virtual void draw(Painter &p, const QRect &r, TextSelection selection, uint64 ms) const = 0;
 
 	virtual void dependencyItemRemoved(HistoryItem *dependency) {
@@ -1227,6 +1297,9 @@ public:
 	virtual TextWithEntities originalText() const {
 		return { QString(), EntitiesInText() };
 	}
+	void addTextMemoryStats(TextMemoryStats &stats) const {
+		_text.addMemoryStats(stats);
+	}
 
 	virtual void drawInfo(Painter &p, int32 right, int32 bottom, int32 width, bool selected, InfoDisplayType type) const {
 	}
@@ -1370,6 +1443,16 @@ public:
 	bool pendingInitDimensions() const {
 		return _flags & MTPDmessage_ClientFlag::f_pending_init_dimensions;
 	}
+	bool fromLocalCache() const {
+		return _flags & MTPDmessage_ClientFlag::f_from_local_cache;
+	}
+	void setFromLocalCache(bool fromLocalCache) {
+		if (fromLocalCache) {
+			_flags |= MTPDmessage_ClientFlag::f_from_local_cache;
+		} else {
+			_flags &= ~MTPDmessage_ClientFlag::f_from_local_cache;
+		}
+	}
 	void setPendingInitDimensions() {
 		_flags |= MTPDmessage_ClientFlag::f_pending_init_dimensions;
 		setPendingResize();
@@ -1428,6 +1511,8 @@ protected:
 	virtual void initDimensions() = 0;
 
 	virtual int resizeGetHeight_(int width) = 0;
+	virtual void prepareResize_(int width) const {
+	}
 
 	void finishEdition(int oldKeyboardTop);
 	void finishEditionToEmpty();
@@ -2697,6 +2782,11 @@ private:
 	void initDimensions() override;
 	int resizeGetHeight_(int width) override;
 	int performResizeGetHeight(int width);
+	void prepareResize_(int width) const override;
+	int countTextWidth(int width) const;
+	const style::textStyle &textStyle() const {
+		return (out() && !isPost()) ? st::outTextStyle : st::inTextStyle;
+	}
 
 	bool displayForwardedFrom() const {
 		if (const HistoryMessageForwarded *fwd = Get<HistoryMessageForwarded>()) {
@@ -331,6 +331,7 @@ void HistoryInner::paintEvent(QPaintEvent *e) {
 	if (!App::main() || (App::wnd() && App::wnd()->contentOverlapped(this, e))) {
 		return;
 	}
+	TRACE_SCOPE("HistoryInner::paintEvent");
 	if (hasPendingResizedItems()) {
 		return;
 	}
@@ -343,6 +344,11 @@ void HistoryInner::paintEvent(QPaintEvent *e) {
 	}
 	uint64 ms = getms();
 
+	// Several repainted items far from each other give a large bounding
+	// rect, so the items between them that are not in the region are skipped.
+	QRegion region(e->region());
+	bool complexRegion = !trivial && (region.rectCount() > 1);
+
 	bool historyDisplayedEmpty = (_history->isDisplayedEmpty() && (!_migrated || _migrated->isDisplayedEmpty()));
 	bool noHistoryDisplayed = _firstLoading || historyDisplayedEmpty;
 	if (!_firstLoading && _botAbout && !_botAbout->info->text.isEmpty() && _botAbout->height > 0) {
@@ -388,24 +394,26 @@ void HistoryInner::paintEvent(QPaintEvent *e) {
 			p.save();
 			p.translate(0, y);
 			if (r.y() < y + item->height()) while (y < drawToY) {
-				TextSelection sel;
-				if (y >= selfromy && y < seltoy) {
-					if (_dragSelecting && !item->serviceMsg() && item->id > 0) {
-						sel = FullSelection;
-					}
-				} else if (hasSel) {
-					auto i = _selected.constFind(item);
-					if (i != selEnd) {
-						sel = i.value();
+				int32 h = item->height();
+				if (!complexRegion || region.intersects(QRect(0, y, width(), h))) {
+					TextSelection sel;
+					if (y >= selfromy && y < seltoy) {
+						if (_dragSelecting && !item->serviceMsg() && item->id > 0) {
+							sel = FullSelection;
+						}
+					} else if (hasSel) {
+						auto i = _selected.constFind(item);
+						if (i != selEnd) {
+							sel = i.value();
+						}
 					}
-				}
-				item->draw(p, r.translated(0, -y), sel, ms);
+					item->draw(p, r.translated(0, -y), sel, ms);
 
-				if (item->hasViews()) {
-					App::main()->scheduleViewIncrement(item);
+					if (item->hasViews()) {
+						App::main()->scheduleViewIncrement(item);
+					}
 				}
 
-				int32 h = item->height();
 				p.translate(0, h);
 				y += h;
 
@@ -434,7 +442,7 @@ void HistoryInner::paintEvent(QPaintEvent *e) {
 			p.translate(0, y);
 			while (y < drawToY) {
 				int32 h = item->height();
-				if (historyRect.y() < y + h && hdrawtop < y + h) {
+				if (historyRect.y() < y + h && hdrawtop < y + h && (!complexRegion || region.intersects(QRect(0, y, width(), h)))) {
 					TextSelection sel;
 					if (y >= selfromy && y < seltoy) {
 						if (_dragSelecting && !item->serviceMsg() && item->id > 0) {
@@ -1602,6 +1610,10 @@ bool HistoryInner::wasSelectedText() const {
 	return _wasSelectedText;
 }
 
+bool HistoryInner::hasSelectionOrDrag() const {
+	return !_selected.isEmpty() || _dragAction != NoDrag;
+}
+
 void HistoryInner::setFirstLoading(bool loading) {
 	_firstLoading = loading;
 	update();
@@ -4002,6 +4014,8 @@ void HistoryWidget::showHistory(const PeerId &peerId, MsgId showAtMsgId, bool re
 
 	_showAtMsgId = showAtMsgId;
 	_histInited = false;
+	_lastUnloadScroll = -1;
+	_newerBlocksUnloaded = false;
 
 	_peer = peerId ? App::peer(peerId) : nullptr;
 	_channel = _peer ? peerToChannel(_peer->id) : NoChannel;
@@ -4064,6 +4078,7 @@ void HistoryWidget::showHistory(const PeerId &peerId, MsgId showAtMsgId, bool re
 		_list->show();
 
 		_updateHistoryItems.stop();
+		_pendingRepaintItems.clear();
 
 		pinnedMsgVisibilityUpdated();
 		if (_history->scrollTopItem || (_migrated && _migrated->scrollTopItem) || _history->isReadyFor(_showAtMsgId)) {
@@ -4122,7 +4137,8 @@ void HistoryWidget::clearAllLoadRequests() {
 	if (_firstLoadRequest) MTP::cancel(_firstLoadRequest);
 	if (_preloadRequest) MTP::cancel(_preloadRequest);
 	if (_preloadDownRequest) MTP::cancel(_preloadDownRequest);
-	_preloadRequest = _preloadDownRequest = _firstLoadRequest = 0;
+	if (_cacheRefreshRequest) MTP::cancel(_cacheRefreshRequest);
+	_preloadRequest = _preloadDownRequest = _firstLoadRequest = _cacheRefreshRequest = 0;
 }
 
 void HistoryWidget::contactsReceived() {
@@ -4581,19 +4597,21 @@ bool HistoryWidget::messagesFailed(const RPCError &error, mtpRequestId requestId
 		Ui::showChatsList();
 	} else if (_delayedShowAtRequest == requestId) {
 		_delayedShowAtRequest = 0;
+	} else if (_cacheRefreshRequest == requestId) {
+		_cacheRefreshRequest = 0;
 	}
 	return true;
 }
 
 void HistoryWidget::messagesReceived(PeerData *peer, const MTPmessages_Messages &messages, mtpRequestId requestId) {
 	if (!_history) {
-		_preloadRequest = _preloadDownRequest = _firstLoadRequest = _delayedShowAtRequest = 0;
+		_preloadRequest = _preloadDownRequest = _firstLoadRequest = _delayedShowAtRequest = _cacheRefreshRequest = 0;
 		return;
 	}
 
 	bool toMigrated = (peer == _peer->migrateFrom());
 	if (peer != _peer && !toMigrated) {
-		_preloadRequest = _preloadDownRequest = _firstLoadRequest = _delayedShowAtRequest = 0;
+		_preloadRequest = _preloadDownRequest = _firstLoadRequest = _delayedShowAtRequest = _cacheRefreshRequest = 0;
 		return;
 	}
 
@@ -4637,6 +4655,10 @@ void HistoryWidget::messagesReceived(PeerData *peer, const MTPmessages_Messages
 			if (_reportSpamStatus != dbiprsUnknown) updateControlsVisibility();
 		}
 	} else if (_preloadDownRequest == requestId) {
+		if (_preloadDownCachedTill) {
+			mergeCachedMessagesDown(*histList);
+			_preloadDownCachedFrom = _preloadDownCachedTill = 0;
+		}
 		addMessagesToBack(peer, *histList);
 		_preloadDownRequest = 0;
 		preloadHistoryIfNeeded();
@@ -4649,6 +4671,10 @@ void HistoryWidget::messagesReceived(PeerData *peer, const MTPmessages_Messages
 		}
 		addMessagesToFront(peer, *histList);
 		_firstLoadRequest = 0;
+		if (_firstLoadLatest && !toMigrated) {
+			Local::writeHistoryCache(peer->id, messages);
+		}
+		_firstLoadLatest = false;
 		if (_history->loadedAtTop()) {
 			if (_history->unreadCount() > count) {
 				_history->setUnreadCount(count);
@@ -4660,6 +4686,14 @@ void HistoryWidget::messagesReceived(PeerData *peer, const MTPmessages_Messages
 		}
 
 		historyLoaded();
+	} else if (_cacheRefreshRequest == requestId) {
+		_cacheRefreshRequest = 0;
+		Local::writeHistoryCache(peer->id, messages);
+		if (_delayedShowAtRequest || _firstLoadRequest) {
+			return; // some other place of the history is being shown already
+		}
+
+		mergeHistoryCache(peer, *histList, count);
 	} else if (_delayedShowAtRequest == requestId) {
 		if (toMigrated) {
 			_history->clear(true);
@@ -4780,9 +4814,197 @@ void HistoryWidget::firstLoadMessages() {
 		}
 	}
 
+	_firstLoadLatest = (from == _peer && !offset_id && !offset && !_migrated);
+	if (_firstLoadLatest && _history->isEmpty() && !_cacheRefreshRequest && showHistoryCache()) {
+		_firstLoadLatest = false;
+		_cacheRefreshRequest = MTP::send(MTPmessages_GetHistory(from->input, MTP_int(0), MTP_int(0), MTP_int(0), MTP_int(loadCount), MTP_int(0), MTP_int(0)), rpcDone(&HistoryWidget::messagesReceived, from), rpcFail(&HistoryWidget::messagesFailed));
+		return;
+	}
+
 	_firstLoadRequest = MTP::send(MTPmessages_GetHistory(from->input, MTP_int(offset_id), MTP_int(0), MTP_int(offset), MTP_int(loadCount), MTP_int(0), MTP_int(0)), rpcDone(&HistoryWidget::messagesReceived, from), rpcFail(&HistoryWidget::messagesFailed));
 }
 
+namespace {
+
+// Feeds the users and chats of the cached page and returns its messages.
+// The channel pts from the cache is outdated, so it is not applied here.
+const QVector<MTPMessage> *feedHistoryCache(const MTPmessages_Messages &cached) {
+	switch (cached.type()) {
+	case mtpc_messages_messages: {
+		auto &d(cached.c_messages_messages());
+		App::feedCachedUsers(d.vusers);
+		App::feedCachedChats(d.vchats);
+		return &d.vmessages.c_vector().v;
+	} break;
+	case mtpc_messages_messagesSlice: {
+		auto &d(cached.c_messages_messagesSlice());
+		App::feedCachedUsers(d.vusers);
+		App::feedCachedChats(d.vchats);
+		return &d.vmessages.c_vector().v;
+	} break;
+	case mtpc_messages_channelMessages: {
+		auto &d(cached.c_messages_channelMessages());
+		App::feedCachedUsers(d.vusers);
+		App::feedCachedChats(d.vchats);
+		return &d.vmessages.c_vector().v;
+	} break;
+	}
+	return nullptr;
+}
+
+} // namespace
+
+bool HistoryWidget::showHistoryCache() {
+	MTPmessages_Messages cached;
+	if (!Local::readHistoryCache(_peer->id, cached)) {
+		return false;
+	}
+
+	auto histList = feedHistoryCache(cached);
+	if (!histList || histList->isEmpty()) {
+		return false;
+	}
+
+	_firstLoadRequest = -1; // hack - don't updateListSize yet
+	addMessagesToFront(_peer, *histList);
+	_firstLoadRequest = 0;
+	if (_history->isEmpty()) {
+		return false;
+	}
+
+	historyLoaded();
+	return true;
+}
+
+// The cached page is on the screen already, so the actual one is merged into it
+// without moving the scroll position: messages deleted on the server are destroyed,
+// edited ones are updated and the new ones are added after the shown ones.
+// If the actual page doesn't overlap the cached one there could be a gap between
+// them, so in that case the cached messages are replaced by the actual ones.
+void HistoryWidget::mergeHistoryCache(PeerData *peer, const QVector<MTPMessage> &messages, int32 count) {
+	MsgId shownMax = _history->maxMsgId(), actualMin = 0;
+	for_const (auto &message, messages) {
+		MsgId id = idFromMessage(message);
+		if (!actualMin || id < actualMin) actualMin = id;
+	}
+	if (actualMin > shownMax) {
+		if (_preloadRequest) MTP::cancel(_preloadRequest);
+		if (_preloadDownRequest) MTP::cancel(_preloadDownRequest);
+		_preloadRequest = _preloadDownRequest = 0;
+
+		_history->clear(true);
+		_firstLoadRequest = -1; // hack - don't updateListSize yet
+		addMessagesToFront(peer, messages);
+		_firstLoadRequest = 0;
+		if (_history->loadedAtTop() && _history->unreadCount() > count) {
+			_history->setUnreadCount(count);
+		}
+
+		_histInited = false;
+		historyLoaded();
+		return;
+	}
+
+	OrderedSet<MsgId> actual;
+	QVector<MTPMessage> newer;
+	for_const (auto &message, messages) {
+		MsgId id = idFromMessage(message);
+		actual.insert(id);
+		if (id > shownMax) {
+			newer.push_back(message);
+		} else if (message.type() == mtpc_message && message.c_message().has_edit_date()) {
+			App::updateEditedMessage(message.c_message());
+		}
+	}
+
+	// All the messages older than the actual page are deleted if the page is the whole history.
+	bool wholeHistory = (messages.size() >= count);
+	QVector<MTPint> deleted;
+	for_const (auto block, _history->blocks) {
+		for_const (auto item, block->items) {
+			if (item->id <= 0 || item->id > shownMax || actual.contains(item->id)) {
+				continue;
+			}
+			if (item->id >= actualMin || wholeHistory) {
+				deleted.push_back(MTP_int(item->id));
+			}
+		}
+	}
+	if (!deleted.isEmpty()) {
+		App::feedWereDeleted(_history->channelId(), deleted);
+	}
+	if (!newer.isEmpty()) {
+		addMessagesToBack(peer, newer);
+	}
+	if (wholeHistory && _history->unreadCount() > count) {
+		_history->setUnreadCount(count);
+	}
+}
+
+// Newer blocks unloaded by unloadFarHistoryBlocks() are often still in the cached
+// newest page, so they are shown from it right away if it continues the loaded ones.
+// Returns the last shown cached message id or 0 if nothing was shown.
+MsgId HistoryWidget::showCachedMessagesDown(MsgId after) {
+	MTPmessages_Messages cached;
+	if (!Local::readHistoryCache(_peer->id, cached)) {
+		return 0;
+	}
+
+	auto histList = feedHistoryCache(cached);
+	if (!histList || histList->isEmpty()) {
+		return 0;
+	}
+
+	MsgId cachedMin = 0, cachedMax = 0;
+	QVector<MTPMessage> newer;
+	for_const (auto &message, *histList) {
+		MsgId id = idFromMessage(message);
+		if (!cachedMin || id < cachedMin) cachedMin = id;
+		accumulate_max(cachedMax, id);
+		if (id > after) {
+			newer.push_back(message);
+		}
+	}
+	if (cachedMin > after || newer.isEmpty()) {
+		return 0; // there could be a gap between the loaded and the cached messages
+	}
+
+	addMessagesToBack(_peer, newer);
+	return cachedMax;
+}
+
+// The server page requested after the cached messages were shown starts from the
+// same place, so it tells which of them were deleted or edited meanwhile.
+void HistoryWidget::mergeCachedMessagesDown(const QVector<MTPMessage> &messages) {
+	MsgId actualMax = 0;
+	OrderedSet<MsgId> actual;
+	for_const (auto &message, messages) {
+		MsgId id = idFromMessage(message);
+		actual.insert(id);
+		accumulate_max(actualMax, id);
+		if (message.type() == mtpc_message && message.c_message().has_edit_date()) {
+			App::updateEditedMessage(message.c_message());
+		}
+	}
+
+	// If the page is not full there is nothing after it.
+	bool toTheEnd = (messages.size() < MessagesPerPage);
+	QVector<MTPint> deleted;
+	for_const (auto block, _history->blocks) {
+		for_const (auto item, block->items) {
+			if (item->id <= _preloadDownCachedFrom || item->id > _preloadDownCachedTill || actual.contains(item->id)) {
+				continue;
+			}
+			if (item->id < actualMax || toTheEnd) {
+				deleted.push_back(MTP_int(item->id));
+			}
+		}
+	}
+	if (!deleted.isEmpty()) {
+		App::feedWereDeleted(_history->channelId(), deleted);
+	}
+}
+
 void HistoryWidget::loadMessages() {
 	if (!_history || _preloadRequest) return;
 
@@ -4824,6 +5046,8 @@ void HistoryWidget::loadMessagesDown() {
 		++offset;
 	}
 
+	_preloadDownCachedTill = (from == _history && _newerBlocksUnloaded) ? showCachedMessagesDown(offset_id) : 0;
+	_preloadDownCachedFrom = _preloadDownCachedTill ? offset_id : 0;
 	_preloadDownRequest = MTP::send(MTPmessages_GetHistory(from->peer->input, MTP_int(offset_id + 1), MTP_int(0), MTP_int(offset), MTP_int(loadCount), MTP_int(0), MTP_int(0)), rpcDone(&HistoryWidget::messagesReceived, from->peer), rpcFail(&HistoryWidget::messagesFailed));
 }
 
@@ -4911,7 +5135,61 @@ void HistoryWidget::preloadHistoryIfNeeded() {
 	if (st != _lastScroll) {
 		_lastScrolled = getms();
 		_lastScroll = st;
+		unloadFarHistoryBlocks();
+	}
+}
+
+void HistoryWidget::unloadFarHistoryBlocks() {
+	if (!_history || !_list || _migrated || _history->blocks.size() < 2) return;
+	if (_preloadRequest || _preloadDownRequest || _delayedShowAtRequest || _a_show.animating()) return;
+	if (_list->hasSelectionOrDrag()) return;
+
+	int top = _list->historyTop();
+	if (top < 0) return;
+
+	// Nothing new can get far enough to be unloaded until we scroll by a screen.
+	int st = _scroll.scrollTop(), sh = _scroll.height();
+	if (_lastUnloadScroll >= 0 && qAbs(st - _lastUnloadScroll) < sh) return;
+	_lastUnloadScroll = st;
+
+	int unloadAbove = st - UnloadHeightsCount * sh - top, unloadBelow = st + sh + UnloadHeightsCount * sh - top;
+
+	const auto &blocks = _history->blocks;
+	int older = 0, newer = 0;
+	for (int l = blocks.size() - 1; older < l; ++older) {
+		auto block = blocks.at(older);
+		if (block->y + block->height >= unloadAbove) break;
+	}
+	for (int l = blocks.size() - 1 - older; newer < l; ++newer) {
+		if (blocks.at(blocks.size() - 1 - newer)->y < unloadBelow) break;
+	}
+
+	// Keep the messages this widget still refers to.
+	bool canRelease = true;
+	HistoryItem *used[] = { _replyEditMsg, _replyReturn, _kbReplyTo };
+	for_const (auto item, used) {
+		if (!item || item->history() != _history) continue;
+		if (item->detached()) {
+			canRelease = false;
+		} else {
+			int index = item->block()->indexInHistory();
+			accumulate_min(older, index);
+			accumulate_min(newer, blocks.size() - 1 - index);
+		}
+	}
+	if (canRelease) {
+		_history->releaseRetainedItems();
 	}
+	if (!older && !newer) return;
+
+	if (newer) {
+		_history->unloadNewerBlocks(newer);
+		_newerBlocksUnloaded = !_history->loadedAtBottom();
+	}
+	_history->unloadOlderBlocks(older);
+	updateListSize();
+	updateToEndVisibility();
+	_lastUnloadScroll = _scroll.scrollTop();
 }
 
 void HistoryWidget::onInlineBotCancel() {
@@ -6704,6 +6982,7 @@ void HistoryWidget::ui_repaintHistoryItem(const HistoryItem *item) {
 		if (_lastScrolled + 100 <= ms) {
 			_list->repaintItem(item);
 		} else {
+			_pendingRepaintItems.insert(item->fullId());
 			_updateHistoryItems.start(_lastScrolled + 100 - ms);
 		}
 	}
@@ -6714,7 +6993,13 @@ void HistoryWidget::onUpdateHistoryItems() {
 
 	uint64 ms = getms();
 	if (_lastScrolled + 100 <= ms) {
-		_list->update();
+		OrderedSet<FullMsgId> items;
+		std::swap(items, _pendingRepaintItems);
+		for_const (auto &itemId, items) {
+			if (auto item = App::histItemById(itemId)) {
+				_list->repaintItem(item);
+			}
+		}
 	} else {
 		_updateHistoryItems.start(_lastScrolled + 100 - ms);
 	}
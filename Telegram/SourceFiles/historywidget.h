@@ -91,6 +91,7 @@ public:
 	void updateBotInfo(bool recount = true);
 
 	bool wasSelectedText() const;
+	bool hasSelectionOrDrag() const;
 	void setFirstLoading(bool loading);
 
 	// updates history->scrollTopItem/scrollTopOffset
@@ -556,6 +557,10 @@ public:
 	void loadMessages();
 	void loadMessagesDown();
 	void firstLoadMessages();
+	bool showHistoryCache();
+	void mergeHistoryCache(PeerData *peer, const QVector<MTPMessage> &messages, int32 count);
+	MsgId showCachedMessagesDown(MsgId after);
+	void mergeCachedMessagesDown(const QVector<MTPMessage> &messages);
 	void delayedShowAt(MsgId showAtMsgId);
 	void peerMessagesUpdated(PeerId peer);
 	void peerMessagesUpdated();
@@ -839,6 +844,7 @@ public slots:
 	// checks if we are too close to the top or to the bottom
 	// in the scroll area and preloads history if needed
 	void preloadHistoryIfNeeded();
+	void unloadFarHistoryBlocks();
 
 private slots:
 
@@ -1044,8 +1050,12 @@ private:
 	MsgId _showAtMsgId = ShowAtUnreadMsgId;
 
 	mtpRequestId _firstLoadRequest = 0;
+	bool _firstLoadLatest = false; // requested the newest page, its result is cached locally
+	mtpRequestId _cacheRefreshRequest = 0; // refreshes the history shown from the local cache
 	mtpRequestId _preloadRequest = 0;
 	mtpRequestId _preloadDownRequest = 0;
+	MsgId _preloadDownCachedFrom = 0; // messages in (from, till] were shown from the local cache
+	MsgId _preloadDownCachedTill = 0;
 
 	MsgId _delayedShowAtMsgId = -1; // wtf?
 	mtpRequestId _delayedShowAtRequest = 0;
@@ -1060,8 +1070,11 @@ private:
 	int _addToScroll = 0;
 
 	int _lastScroll = 0;// gifs optimization
+	int _lastUnloadScroll = -1; // scrollTop() when far blocks were last checked
+	bool _newerBlocksUnloaded = false; // they may be shown from the local cache again
 	uint64 _lastScrolled = 0;
 	QTimer _updateHistoryItems;
+	OrderedSet<FullMsgId> _pendingRepaintItems; // repainted when the scroll settles
 
 	ChildWidget<Ui::HistoryDownButton> _historyToEnd;
 
@@ -298,15 +298,8 @@ namespace {
 		}
 	};
 
-	bool readFile(FileReadDescriptor &result, const QString &name, int options = UserPath | SafePath) {
-		if (options & UserPath) {
-			if (!_userWorking()) return false;
-		} else {
-			if (!_working()) return false;
-		}
-
-		// detect order of read attempts
-		QString toTry[2];
+	// detect order of read attempts
+	void _readFileOrder(QString toTry[2], const QString &name, int options) {
 		toTry[0] = ((options & UserPath) ? _userBasePath : _basePath) + name + '0';
 		if (options & SafePath) {
 			QFileInfo toTry0(toTry[0]);
@@ -325,6 +318,44 @@ namespace {
 				toTry[0][toTry[0].size() - 1] = '1';
 			}
 		}
+	}
+
+	// checks magic, app version and md5 signature of the file contents, dataSize bytes of data are followed by the signature
+	bool _checkFileData(const QString &name, const char *magic, qint32 version, const char *data, int32 dataSize) {
+		if (memcmp(magic, tdfMagic, tdfMagicLen)) {
+			DEBUG_LOG(("App Info: bad magic %1 in '%2'").arg(Logs::mb(magic, tdfMagicLen).str()).arg(name));
+			return false;
+		}
+		if (version > AppVersion) {
+			DEBUG_LOG(("App Info: version too big %1 for '%2', my version %3").arg(version).arg(name).arg(AppVersion));
+			return false;
+		}
+		if (dataSize < 0) {
+			DEBUG_LOG(("App Info: bad file '%1', could not read sign part").arg(name));
+			return false;
+		}
+
+		HashMd5 md5;
+		md5.feed(data, dataSize);
+		md5.feed(&dataSize, sizeof(dataSize));
+		md5.feed(&version, sizeof(version));
+		md5.feed(magic, tdfMagicLen);
+		if (memcmp(md5.result(), data + dataSize, 16)) {
+			DEBUG_LOG(("App Info: bad file '%1', signature did not match").arg(name));
+			return false;
+		}
+		return true;
+	}
+
+	bool readFile(FileReadDescriptor &result, const QString &name, int options = UserPath | SafePath) {
+		if (options & UserPath) {
+			if (!_userWorking()) return false;
+		} else {
+			if (!_working()) return false;
+		}
+
+		QString toTry[2];
+		_readFileOrder(toTry, name, options);
 		for (int32 i = 0; i < 2; ++i) {
 			QString fname(toTry[i]);
 			if (fname.isEmpty()) break;
@@ -335,44 +366,22 @@ namespace {
 				continue;
 			}
 
-			// check magic
+			// read magic and app version
 			char magic[tdfMagicLen];
 			if (f.read(magic, tdfMagicLen) != tdfMagicLen) {
 				DEBUG_LOG(("App Info: failed to read magic from '%1'").arg(name));
 				continue;
 			}
-			if (memcmp(magic, tdfMagic, tdfMagicLen)) {
-				DEBUG_LOG(("App Info: bad magic %1 in '%2'").arg(Logs::mb(magic, tdfMagicLen).str()).arg(name));
-				continue;
-			}
-
-			// read app version
 			qint32 version;
 			if (f.read((char*)&version, sizeof(version)) != sizeof(version)) {
 				DEBUG_LOG(("App Info: failed to read version from '%1'").arg(name));
 				continue;
 			}
-			if (version > AppVersion) {
-				DEBUG_LOG(("App Info: version too big %1 for '%2', my version %3").arg(version).arg(name).arg(AppVersion));
-				continue;
-			}
 
-			// read data
+			// read data and check signature
 			QByteArray bytes = f.read(f.size());
 			int32 dataSize = bytes.size() - 16;
-			if (dataSize < 0) {
-				DEBUG_LOG(("App Info: bad file '%1', could not read sign part").arg(name));
-				continue;
-			}
-
-			// check signature
-			HashMd5 md5;
-			md5.feed(bytes.constData(), dataSize);
-			md5.feed(&dataSize, sizeof(dataSize));
-			md5.feed(&version, sizeof(version));
-			md5.feed(magic, tdfMagicLen);
-			if (memcmp(md5.result(), bytes.constData() + dataSize, 16)) {
-				DEBUG_LOG(("App Info: bad file '%1', signature did not match").arg(name));
+			if (!_checkFileData(name, magic, version, bytes.constData(), dataSize)) {
 				continue;
 			}
 
@@ -395,16 +404,16 @@ namespace {
 		return false;
 	}
 
-	bool decryptLocal(EncryptedDescriptor &result, const QByteArray &encrypted, const MTP::AuthKey &key = _localKey) {
-		if (encrypted.size() <= 16 || (encrypted.size() & 0x0F)) {
-			LOG(("App Error: bad encrypted part size: %1").arg(encrypted.size()));
+	// decrypts and checks the encrypted part, the result starts with its uint32 length
+	bool _decryptLocalData(QByteArray &decrypted, const char *encrypted, int32 encryptedSize, const MTP::AuthKey &key) {
+		if (encryptedSize <= 16 || (encryptedSize & 0x0F)) {
+			LOG(("App Error: bad encrypted part size: %1").arg(encryptedSize));
 			return false;
 		}
-		uint32 fullLen = encrypted.size() - 16;
+		uint32 fullLen = encryptedSize - 16;
 
-		QByteArray decrypted;
 		decrypted.resize(fullLen);
-		const char *encryptedKey = encrypted.constData(), *encryptedData = encrypted.constData() + 16;
+		const char *encryptedKey = encrypted, *encryptedData = encrypted + 16;
 		aesDecryptLocal(encryptedData, decrypted.data(), fullLen, &key, encryptedKey);
 		uchar sha1Buffer[20];
 		if (memcmp(hashSha1(decrypted.constData(), decrypted.size(), sha1Buffer), encryptedKey, 16)) {
@@ -419,6 +428,14 @@ namespace {
 		}
 
 		decrypted.resize(dataLen);
+		return true;
+	}
+
+	bool decryptLocal(EncryptedDescriptor &result, const QByteArray &encrypted, const MTP::AuthKey &key = _localKey) {
+		QByteArray decrypted;
+		if (!_decryptLocalData(decrypted, encrypted.constData(), encrypted.size(), key)) {
+			return false;
+		}
 		result.data = decrypted;
 		decrypted = QByteArray();
 
@@ -465,6 +482,129 @@ namespace {
 		return readEncryptedFile(result, toFilePart(fkey), options, key);
 	}
 
+	// Holds a decrypted file, the stream reads from it without copying.
+	struct MappedReadDescriptor {
+		int32 version = 0;
+		QByteArray data;
+		QBuffer buffer;
+		QDataStream stream;
+
+		// Reads a serialized QByteArray by moving its bytes to the start of the decrypted
+		// buffer and handing the buffer out, so the payload is never copied.
+		bool takeByteArray(QByteArray &result) {
+			quint32 size = 0;
+			stream >> size;
+			if (stream.status() != QDataStream::Ok) {
+				return false;
+			}
+			if (size == 0xffffffff) {
+				result = QByteArray();
+				return true;
+			}
+			int offset = int(buffer.pos());
+			if (size > quint32(data.size() - offset)) {
+				return false;
+			}
+			clearStream();
+			memmove(data.data(), data.constData() + offset, size);
+			data.resize(size);
+			result = data;
+			data = QByteArray();
+			return true;
+		}
+		void clearStream() {
+			stream.setDevice(0);
+			if (buffer.isOpen()) buffer.close();
+			buffer.setBuffer(0);
+		}
+		void clear() {
+			clearStream();
+			data = QByteArray();
+			version = 0;
+		}
+		~MappedReadDescriptor() {
+			clear();
+		}
+	};
+
+	// Maps the file and decrypts the encrypted part straight from the mapping,
+	// skipping the read and the intermediate copies made by readEncryptedFile().
+	// Returns false with mapped == false if the file could not be mapped,
+	// so the caller can fall back.
+	bool readMappedEncryptedFile(MappedReadDescriptor &result, const QString &name, int options, bool &mapped, const MTP::AuthKey &key = _localKey) {
+		mapped = false;
+		if (options & UserPath) {
+			if (!_userWorking()) return false;
+		} else {
+			if (!_working()) return false;
+		}
+
+		QString toTry[2];
+		_readFileOrder(toTry, name, options);
+		for (int32 i = 0; i < 2; ++i) {
+			QString fname(toTry[i]);
+			if (fname.isEmpty()) break;
+
+			QFile f(fname);
+			if (!f.open(QIODevice::ReadOnly)) {
+				DEBUG_LOG(("App Info: failed to open '%1' for reading").arg(name));
+				continue;
+			}
+			qint64 fileSize = f.size();
+			if (fileSize < tdfMagicLen + qint64(sizeof(qint32)) + 16 || fileSize > INT_MAX) {
+				DEBUG_LOG(("App Info: bad file '%1', size %2").arg(name).arg(fileSize));
+				continue;
+			}
+			const uchar *bytes = f.map(0, fileSize);
+			if (!bytes) {
+				return false;
+			}
+			mapped = true;
+
+			const char *magic = reinterpret_cast<const char*>(bytes);
+			qint32 version;
+			memcpy(&version, bytes + tdfMagicLen, sizeof(version));
+			const char *data = magic + tdfMagicLen + sizeof(version);
+			int32 dataSize = int32(fileSize) - tdfMagicLen - sizeof(version) - 16;
+			if (!_checkFileData(name, magic, version, data, dataSize)) {
+				continue;
+			}
+
+			// the encrypted part is the first serialized QByteArray in the data
+			if (dataSize < int32(sizeof(quint32))) {
+				DEBUG_LOG(("App Info: bad file '%1', could not read encrypted part").arg(name));
+				continue;
+			}
+			quint32 encryptedSize = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(data));
+			if (encryptedSize == 0xffffffff || encryptedSize > uint32(dataSize) - sizeof(quint32)) {
+				DEBUG_LOG(("App Info: bad file '%1', bad encrypted part size %2").arg(name).arg(encryptedSize));
+				continue;
+			}
+
+			QByteArray decrypted;
+			if (!_decryptLocalData(decrypted, data + sizeof(quint32), int32(encryptedSize), key)) {
+				return false;
+			}
+			f.unmap(const_cast<uchar*>(bytes));
+			f.close();
+
+			result.clear();
+			result.version = version;
+			result.data = decrypted;
+			result.buffer.setBuffer(&result.data);
+			result.buffer.open(QIODevice::ReadOnly);
+			result.buffer.seek(sizeof(uint32)); // skip len
+			result.stream.setDevice(&result.buffer);
+			result.stream.setVersion(QDataStream::Qt_5_1);
+
+			if ((i == 0 && !toTry[1].isEmpty()) || i == 1) {
+				QFile::remove(toTry[1 - i]);
+			}
+			return true;
+		}
+		return false;
+	}
+
 	FileKey _dataNameKey = 0;
 
 	enum { // Local Storage Keys
@@ -484,6 +624,8 @@ namespace {
 		lskReportSpamStatuses    = 0x0d, // no data
 		lskSavedGifsOld          = 0x0e, // no data
 		lskSavedGifs             = 0x0f, // no data
+		lskHistoryCache          = 0x10, // data: PeerId peer
+		lskDialogsCache          = 0x11, // no data
 	};
 
 	enum {
@@ -552,7 +694,8 @@ namespace {
 
 
 	typedef QMap<PeerId, FileKey> DraftsMap;
-	DraftsMap _draftsMap, _draftCursorsMap;
+	DraftsMap _draftsMap, _draftCursorsMap, _historyCacheMap;
+	QList<PeerId> _historyCacheOrder; // most recently written first, at most HistoryCacheLimit
 	typedef QMap<PeerId, bool> DraftsNotReadMap;
 	DraftsNotReadMap _draftsNotReadMap;
 
@@ -580,6 +723,7 @@ namespace {
 	bool _recentHashtagsAndBotsWereRead = false;
 
 	FileKey _savedPeersKey = 0;
+	FileKey _dialogsCacheKey = 0;
 
 	typedef QMap<StorageKey, FileDesc> StorageMap;
 	StorageMap _imagesMap, _stickerImagesMap, _audiosMap;
@@ -1710,13 +1854,15 @@ namespace {
 		}
 		LOG(("App Info: reading encrypted map..."));
 
-		DraftsMap draftsMap, draftCursorsMap;
+		DraftsMap draftsMap, draftCursorsMap, historyCacheMap;
+		QList<PeerId> historyCacheOrder;
 		DraftsNotReadMap draftsNotReadMap;
 		StorageMap imagesMap, stickerImagesMap, audiosMap;
 		qint64 storageImagesSize = 0, storageStickersSize = 0, storageAudiosSize = 0;
 		quint64 locationsKey = 0, reportSpamStatusesKey = 0;
 		quint64 recentStickersKeyOld = 0, stickersKey = 0, savedGifsKey = 0;
 		quint64 backgroundKey = 0, userSettingsKey = 0, recentHashtagsAndBotsKey = 0, savedPeersKey = 0;
+		quint64 dialogsCacheKey = 0;
 		while (!map.stream.atEnd()) {
 			quint32 keyType;
 			map.stream >> keyType;
@@ -1742,6 +1888,17 @@ namespace {
 					draftCursorsMap.insert(p, key);
 				}
 			} break;
+			case lskHistoryCache: {
+				quint32 count = 0;
+				map.stream >> count;
+				for (quint32 i = 0; i < count; ++i) {
+					FileKey key;
+					quint64 p;
+					map.stream >> key >> p;
+					historyCacheMap.insert(p, key);
+					historyCacheOrder.push_back(p);
+				}
+			} break;
 			case lskImages: {
 				quint32 count = 0;
 				map.stream >> count;
@@ -1809,6 +1966,9 @@ namespace {
 			case lskSavedPeers: {
 				map.stream >> savedPeersKey;
 			} break;
+			case lskDialogsCache: {
+				map.stream >> dialogsCacheKey;
+			} break;
 			default:
 				LOG(("App Error: unknown key type in encrypted map: %1").arg(keyType));
 				return Local::ReadMapFailed;
@@ -1821,6 +1981,8 @@ namespace {
 		_draftsMap = draftsMap;
 		_draftCursorsMap = draftCursorsMap;
 		_draftsNotReadMap = draftsNotReadMap;
+		_historyCacheMap = historyCacheMap;
+		_historyCacheOrder = historyCacheOrder;
 
 		_imagesMap = imagesMap;
 		_storageImagesSize = storageImagesSize;
@@ -1835,6 +1997,7 @@ namespace {
 		_stickersKey = stickersKey;
 		_savedGifsKey = savedGifsKey;
 		_savedPeersKey = savedPeersKey;
+		_dialogsCacheKey = dialogsCacheKey;
 		_backgroundKey = backgroundKey;
 		_userSettingsKey = userSettingsKey;
 		_recentHashtagsAndBotsKey = recentHashtagsAndBotsKey;
@@ -1899,6 +2062,7 @@ namespace {
 		uint32 mapSize = 0;
 		if (!_draftsMap.isEmpty()) mapSize += sizeof(quint32) * 2 + _draftsMap.size() * sizeof(quint64) * 2;
 		if (!_draftCursorsMap.isEmpty()) mapSize += sizeof(quint32) * 2 + _draftCursorsMap.size() * sizeof(quint64) * 2;
+		if (!_historyCacheMap.isEmpty()) mapSize += sizeof(quint32) * 2 + _historyCacheMap.size() * sizeof(quint64) * 2;
 		if (!_imagesMap.isEmpty()) mapSize += sizeof(quint32) * 2 + _imagesMap.size() * (sizeof(quint64) * 3 + sizeof(qint32));
 		if (!_stickerImagesMap.isEmpty()) mapSize += sizeof(quint32) * 2 + _stickerImagesMap.size() * (sizeof(quint64) * 3 + sizeof(qint32));
 		if (!_audiosMap.isEmpty()) mapSize += sizeof(quint32) * 2 + _audiosMap.size() * (sizeof(quint64) * 3 + sizeof(qint32));
@@ -1908,6 +2072,7 @@ namespace {
 		if (_stickersKey) mapSize += sizeof(quint32) + sizeof(quint64);
 		if (_savedGifsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 		if (_savedPeersKey) mapSize += sizeof(quint32) + sizeof(quint64);
+		if (_dialogsCacheKey) mapSize += sizeof(quint32) + sizeof(quint64);
 		if (_backgroundKey) mapSize += sizeof(quint32) + sizeof(quint64);
 		if (_userSettingsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 		if (_recentHashtagsAndBotsKey) mapSize += sizeof(quint32) + sizeof(quint64);
@@ -1924,6 +2089,12 @@ namespace {
 				mapData.stream << quint64(i.value()) << quint64(i.key());
 			}
 		}
+		if (!_historyCacheMap.isEmpty()) {
+			mapData.stream << quint32(lskHistoryCache) << quint32(_historyCacheMap.size());
+			for_const (auto peer, _historyCacheOrder) {
+				mapData.stream << quint64(_historyCacheMap.value(peer)) << quint64(peer);
+			}
+		}
 		if (!_imagesMap.isEmpty()) {
 			mapData.stream << quint32(lskImages) << quint32(_imagesMap.size());
 			for (StorageMap::const_iterator i = _imagesMap.cbegin(), e = _imagesMap.cend(); i != e; ++i) {
@@ -1960,6 +2131,9 @@ namespace {
 		if (_savedPeersKey) {
 			mapData.stream << quint32(lskSavedPeers) << quint64(_savedPeersKey);
 		}
+		if (_dialogsCacheKey) {
+			mapData.stream << quint32(lskDialogsCache) << quint64(_dialogsCacheKey);
+		}
 		if (_backgroundKey) {
 			mapData.stream << quint32(lskBackground) << quint64(_backgroundKey);
 		}
@@ -2226,6 +2400,8 @@ namespace Local {
 		_passKeySalt.clear(); // reset passcode, local key
 		_draftsMap.clear();
 		_draftCursorsMap.clear();
+		_historyCacheMap.clear();
+		_historyCacheOrder.clear();
 		_fileLocations.clear();
 		_fileLocationPairs.clear();
 		_fileLocationAliases.clear();
@@ -2239,6 +2415,7 @@ namespace Local {
 		_locationsKey = _reportSpamStatusesKey = 0;
 		_recentStickersKeyOld = _stickersKey = _savedGifsKey = 0;
 		_backgroundKey = _userSettingsKey = _recentHashtagsAndBotsKey = _savedPeersKey = 0;
+		_dialogsCacheKey = 0;
 		_oldMapVersion = _oldSettingsVersion = 0;
 		_mapChanged = true;
 		_writeMap(WriteMapNow);
@@ -2460,6 +2637,148 @@ namespace Local {
 		return _draftsMap.contains(peer);
 	}
 
+	void writeHistoryCache(const PeerId &peer, const MTPmessages_Messages &messages) {
+		if (!_working()) return;
+
+		auto i = _historyCacheMap.constFind(peer);
+		if (i == _historyCacheMap.cend()) {
+			while (_historyCacheOrder.size() >= HistoryCacheLimit) {
+				auto evicted = _historyCacheMap.find(_historyCacheOrder.takeLast());
+				if (evicted != _historyCacheMap.cend()) {
+					clearKey(evicted.value());
+					_historyCacheMap.erase(evicted);
+				}
+			}
+			i = _historyCacheMap.insert(peer, genKey());
+			_historyCacheOrder.push_front(peer);
+			_mapChanged = true;
+			_writeMap(WriteMapFast);
+		} else if (_historyCacheOrder.front() != peer) {
+			_historyCacheOrder.removeOne(peer);
+			_historyCacheOrder.push_front(peer);
+			_mapChanged = true;
+			_writeMap(WriteMapSoon);
+		}
+
+		mtpBuffer buffer;
+		buffer.reserve(messages.innerLength() >> 2);
+		messages.write(buffer);
+		auto serialized = QByteArray::fromRawData(reinterpret_cast<const char*>(buffer.constData()), buffer.size() * sizeof(mtpPrime));
+
+		EncryptedDescriptor data(sizeof(quint64) + Serialize::bytearraySize(serialized));
+		data.stream << quint64(peer) << serialized;
+
+		FileWriteDescriptor file(i.value());
+		file.writeEncrypted(data);
+	}
+
+	void clearHistoryCache(const PeerId &peer) {
+		auto i = _historyCacheMap.find(peer);
+		if (i != _historyCacheMap.cend()) {
+			clearKey(i.value());
+			_historyCacheMap.erase(i);
+			_historyCacheOrder.removeOne(peer);
+			_mapChanged = true;
+			_writeMap();
+		}
+	}
+
+	bool readHistoryCache(const PeerId &peer, MTPmessages_Messages &messages) {
+		auto j = _historyCacheMap.constFind(peer);
+		if (j == _historyCacheMap.cend()) {
+			return false;
+		}
+
+		FileReadDescriptor cache;
+		if (!readEncryptedFile(cache, j.value())) {
+			clearHistoryCache(peer);
+			return false;
+		}
+
+		quint64 cachePeer = 0;
+		QByteArray serialized;
+		cache.stream >> cachePeer >> serialized;
+		if (!_checkStreamStatus(cache.stream) || cachePeer != peer || serialized.isEmpty() || (serialized.size() % sizeof(mtpPrime))) {
+			clearHistoryCache(peer);
+			return false;
+		}
+
+		auto from = reinterpret_cast<const mtpPrime*>(serialized.constData());
+		auto end = from + (serialized.size() / sizeof(mtpPrime));
+		try {
+			messages.read(from, end);
+		} catch (Exception &) {
+			LOG(("App Error: could not read history cache for peer %1").arg(peer));
+			clearHistoryCache(peer);
+			return false;
+		}
+		return true;
+	}
+
+	bool hasHistoryCache(const PeerId &peer) {
+		return _historyCacheMap.contains(peer);
+	}
+
+	void writeDialogsCache(const MTPmessages_Dialogs &dialogs) {
+		if (!_working()) return;
+
+		if (!_dialogsCacheKey) {
+			_dialogsCacheKey = genKey();
+			_mapChanged = true;
+			_writeMap(WriteMapFast);
+		}
+
+		mtpBuffer buffer;
+		buffer.reserve(dialogs.innerLength() >> 2);
+		dialogs.write(buffer);
+		auto serialized = QByteArray::fromRawData(reinterpret_cast<const char*>(buffer.constData()), buffer.size() * sizeof(mtpPrime));
+
+		EncryptedDescriptor data(Serialize::bytearraySize(serialized));
+		data.stream << serialized;
+
+		FileWriteDescriptor file(_dialogsCacheKey);
+		file.writeEncrypted(data);
+	}
+
+	void clearDialogsCache() {
+		if (_dialogsCacheKey) {
+			clearKey(_dialogsCacheKey);
+			_dialogsCacheKey = 0;
+			_mapChanged = true;
+			_writeMap();
+		}
+	}
+
+	bool readDialogsCache(MTPmessages_Dialogs &dialogs) {
+		if (!_dialogsCacheKey) {
+			return false;
+		}
+
+		FileReadDescriptor cache;
+		if (!readEncryptedFile(cache, _dialogsCacheKey)) {
+			clearDialogsCache();
+			return false;
+		}
+
+		QByteArray serialized;
+		cache.stream >> serialized;
+		if (!_checkStreamStatus(cache.stream) || serialized.isEmpty() || (serialized.size() % sizeof(mtpPrime))) {
+			clearDialogsCache();
+			return false;
+		}
+
+		auto from = reinterpret_cast<const mtpPrime*>(serialized.constData());
+		auto end = from + (serialized.size() / sizeof(mtpPrime));
+		try {
+			dialogs.read(from, end);
+		} catch (Exception &) {
+			LOG(("App Error: could not read dialogs cache"));
+			clearDialogsCache();
+			return false;
+		}
+		return true;
+	}
+
 	void writeFileLocation(MediaKey location, const FileLocation &local) {
 		if (local.fname.isEmpty()) return;
 
@@ -2587,15 +2906,29 @@ namespace Local {
 			_key(key), _location(location), _readImageFlag(readImageFlag), _loader(loader), _result(0) {
 		}
 		void process() {
-			FileReadDescriptor image;
-			if (!readEncryptedFile(image, _key, UserPath)) {
-				return;
-			}
+			TRACE_SCOPE("Local::cachedLoad");
 
 			QByteArray imageData;
 			quint64 locFirst, locSecond;
 			quint32 imageType;
-			readFromStream(image.stream, locFirst, locSecond, imageType, imageData);
+
+			bool mapped = false;
+			MappedReadDescriptor image;
+			if (readMappedEncryptedFile(image, toFilePart(_key), UserPath, mapped)) {
+				readHeaderFromStream(image.stream, locFirst, locSecond, imageType);
+				if (!image.takeByteArray(imageData)) {
+					return;
+				}
+			} else if (mapped) {
+				return;
+			} else {
+				FileReadDescriptor file;
+				if (!readEncryptedFile(file, _key, UserPath)) {
+					return;
+				}
+				readHeaderFromStream(file.stream, locFirst, locSecond, imageType);
+				file.stream >> imageData;
+			}
 
 			// we're saving files now before we have actual location
 			//if (locFirst != _location.first || locSecond != _location.second) {
@@ -2612,7 +2945,7 @@ namespace Local {
 				_loader->localLoaded(StorageImageSaved());
 			}
 		}
-		virtual void readFromStream(QDataStream &stream, quint64 &first, quint64 &second, quint32 &type, QByteArray &data) = 0;
+		virtual void readHeaderFromStream(QDataStream &stream, quint64 &first, quint64 &second, quint32 &type) = 0; // the data follows the header
 		virtual void clearInMap() = 0;
 		virtual ~AbstractCachedLoadTask() {
 			deleteAndMark(_result);
@@ -2633,6 +2966,7 @@ namespace Local {
 						case StorageFileWebp: guessFormat = "WEBP"; break;
 						default: guessFormat = QByteArray(); break;
 					}
+					TRACE_SCOPE("Local::cachedLoad decode");
 					pixmap = QPixmap::fromImage(App::readImage(data, &guessFormat, false), Qt::ColorOnly);
 					if (!pixmap.isNull()) {
 						format = guessFormat;
@@ -2653,8 +2987,8 @@ namespace Local {
 		ImageLoadTask(const FileKey &key, const StorageKey &location, mtpFileLoader *loader) :
 		AbstractCachedLoadTask(key, location, true, loader) {
 		}
-		void readFromStream(QDataStream &stream, quint64 &first, quint64 &second, quint32 &type, QByteArray &data) {
-			stream >> first >> second >> type >> data;
+		void readHeaderFromStream(QDataStream &stream, quint64 &first, quint64 &second, quint32 &type) {
+			stream >> first >> second >> type;
 		}
 		void clearInMap() {
 			StorageMap::iterator j = _imagesMap.find(_location);
@@ -2711,8 +3045,8 @@ namespace Local {
 		StickerImageLoadTask(const FileKey &key, const StorageKey &location, mtpFileLoader *loader) :
 		AbstractCachedLoadTask(key, location, true, loader) {
 		}
-		void readFromStream(QDataStream &stream, quint64 &first, quint64 &second, quint32 &type, QByteArray &data) {
-			stream >> first >> second >> data;
+		void readHeaderFromStream(QDataStream &stream, quint64 &first, quint64 &second, quint32 &type) {
+			stream >> first >> second;
 			type = StorageFilePartial;
 		}
 		void clearInMap() {
@@ -2785,8 +3119,8 @@ namespace Local {
 		AudioLoadTask(const FileKey &key, const StorageKey &location, mtpFileLoader *loader) :
 		AbstractCachedLoadTask(key, location, false, loader) {
 		}
-		void readFromStream(QDataStream &stream, quint64 &first, quint64 &second, quint32 &type, QByteArray &data) {
-			stream >> first >> second >> data;
+		void readHeaderFromStream(QDataStream &stream, quint64 &first, quint64 &second, quint32 &type) {
+			stream >> first >> second;
 			type = StorageFilePartial;
 		}
 		void clearInMap() {
@@ -3840,6 +4174,11 @@ namespace Local {
 				_draftCursorsMap.clear();
 				_mapChanged = true;
 			}
+			if (!_historyCacheMap.isEmpty()) {
+				_historyCacheMap.clear();
+				_historyCacheOrder.clear();
+				_mapChanged = true;
+			}
 			if (_locationsKey) {
 				_locationsKey = 0;
 				_mapChanged = true;
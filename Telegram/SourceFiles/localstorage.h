@@ -122,6 +122,15 @@ namespace Local {
 	bool hasDraftCursors(const PeerId &peer);
 	bool hasDraft(const PeerId &peer);
 
+	void writeHistoryCache(const PeerId &peer, const MTPmessages_Messages &messages);
+	bool readHistoryCache(const PeerId &peer, MTPmessages_Messages &messages);
+	void clearHistoryCache(const PeerId &peer);
+	bool hasHistoryCache(const PeerId &peer);
+
+	void writeDialogsCache(const MTPmessages_Dialogs &dialogs);
+	bool readDialogsCache(MTPmessages_Dialogs &dialogs);
+	void clearDialogsCache();
+
 	void writeFileLocation(MediaKey location, const FileLocation &local);
 	FileLocation readFileLocation(MediaKey location, bool check = true);
 
@@ -557,6 +557,101 @@ namespace Logs {
 		return idsStr + "]";
 	}
 
+	namespace Trace {
+
+		namespace internal {
+			QAtomicInt Enabled;
+		} // namespace internal
+
+		namespace {
+
+			enum {
+				TraceEventsCount = 65536, // last events kept in the ring buffer
+			};
+
+			struct TraceEvent {
+				const char *name;
+				int64 start;
+				int64 duration;
+				quintptr thread;
+			};
+
+			QMutex TraceMutex;
+			TraceEvent *TraceEvents = nullptr;
+			int TraceEventsAdded = 0;
+
+			QElapsedTimer &TraceTimer() {
+				static QElapsedTimer result;
+				return result;
+			}
+
+		} // namespace
+
+		void start() {
+			QMutexLocker lock(&TraceMutex);
+			if (!TraceEvents) {
+				TraceEvents = new TraceEvent[TraceEventsCount];
+			}
+			TraceEventsAdded = 0;
+			TraceTimer().start();
+			internal::Enabled.store(1);
+		}
+
+		QString stop() {
+			internal::Enabled.store(0);
+
+			QMutexLocker lock(&TraceMutex);
+			if (!TraceEvents) return QString();
+
+			auto count = qMin(TraceEventsAdded, int(TraceEventsCount));
+			auto from = TraceEventsAdded - count;
+
+			QByteArray json;
+			json.reserve(count * 96 + 32);
+			json.append("{\"traceEvents\":[");
+			for (auto i = 0; i < count; ++i) {
+				auto &event = TraceEvents[(from + i) % TraceEventsCount];
+				if (i) json.append(',');
+				json.append("\n{\"name\":\"").append(event.name);
+				json.append("\",\"ph\":\"X\",\"pid\":1,\"tid\":").append(QByteArray::number(quint64(event.thread)));
+				json.append(",\"ts\":").append(QByteArray::number(event.start));
+				json.append(",\"dur\":").append(QByteArray::number(event.duration)).append('}');
+			}
+			json.append("\n]}\n");
+
+			delete[] TraceEvents;
+			TraceEvents = nullptr;
+			TraceEventsAdded = 0;
+
+			auto path = cWorkingDir() + qsl("tdata/trace_%1.json").arg(QDateTime::currentDateTime().toString(qsl("yyyyMMdd_hhmmss")));
+			QFile f(path);
+			if (!f.open(QIODevice::WriteOnly) || f.write(json) != json.size()) {
+				LOG(("Trace Error: could not write '%1'").arg(path));
+				return QString();
+			}
+			return path;
+		}
+
+		int64 now() {
+			return TraceTimer().nsecsElapsed() / 1000;
+		}
+
+		void record(const char *name, int64 start, int64 duration) {
+			QMutexLocker lock(&TraceMutex);
+			if (!TraceEvents) return;
+
+			auto &event = TraceEvents[TraceEventsAdded % TraceEventsCount];
+			event.name = name;
+			event.start = start;
+			event.duration = duration;
+			event.thread = reinterpret_cast<quintptr>(QThread::currentThreadId());
+			if (++TraceEventsAdded == 2 * TraceEventsCount) {
+				TraceEventsAdded = TraceEventsCount; // keep the position in the ring, avoid the overflow
+			}
+		}
+
+	} // namespace Trace
+
 }
 
 void _moveOldDataFiles(const QString &wasDir) {
@@ -72,6 +72,43 @@ namespace Logs {
 	QString vector(const QVector<MTPlong> &ids);
 	QString vector(const QVector<uint64> &ids);
 
+	// Frame time tracing: scoped timers put complete events to a ring buffer
+	// that is written to tdata/ in the Chrome trace JSON format when stopped.
+	namespace Trace {
+
+		namespace internal {
+			extern QAtomicInt Enabled;
+		} // namespace internal
+
+		inline bool enabled() {
+			return internal::Enabled.load() != 0;
+		}
+		void start();
+		QString stop(); // returns the written file path, empty on failure
+
+		int64 now(); // in microseconds
+		void record(const char *name, int64 start, int64 duration);
+
+		class Scope {
+		public:
+			explicit Scope(const char *name) : _name(enabled() ? name : nullptr), _start(_name ? now() : 0) {
+			}
+			Scope(const Scope &other) = delete;
+			Scope &operator=(const Scope &other) = delete;
+			~Scope() {
+				if (_name) {
+					record(_name, _start, now() - _start);
+				}
+			}
+
+		private:
+			const char *_name;
+			int64 _start;
+
+		};
+
+	} // namespace Trace
+
 }
 
 #define LOG(msg) (Logs::writeMain(QString msg))
@@ -86,6 +123,9 @@ namespace Logs {
 #define MTP_LOG(dc, msg) { if (cDebug() || !Logs::started()) Logs::writeMtp(dc, QString msg); }
 //usage MTP_LOG(dc, ("log: %1 %2").arg(1).arg(2))
 
+#define TRACE_SCOPE(name) Logs::Trace::Scope traceScope(name)
+//usage TRACE_SCOPE("HistoryInner::paintEvent"), the name must be a string literal
+
 namespace SignalHandlers {
 
 	struct dump {
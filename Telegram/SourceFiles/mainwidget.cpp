@@ -84,6 +84,7 @@ MainWidget::MainWidget(MainWindow *window) : TWidget(window)
 	connect(&_byPtsTimer, SIGNAL(timeout()), this, SLOT(onGetDifferenceTimeByPts()));
 	connect(&_byMinChannelTimer, SIGNAL(timeout()), this, SLOT(getDifference()));
 	connect(&_failDifferenceTimer, SIGNAL(timeout()), this, SLOT(onGetDifferenceTimeAfterFail()));
+	connect(&_differenceApplyTimer, SIGNAL(timeout()), this, SLOT(onApplyDifferenceChunk()));
 	connect(_api.get(), SIGNAL(fullPeerUpdated(PeerData*)), this, SLOT(onFullPeerUpdated(PeerData*)));
 	connect(this, SIGNAL(peerUpdated(PeerData*)), _history, SLOT(peerUpdated(PeerData*)));
 	connect(_topBar, SIGNAL(clicked()), this, SLOT(onTopBarClick()));
@@ -789,6 +790,7 @@ void MainWidget::deleteConversation(PeerData *peer, bool deleteHistory) {
 		h->newLoaded = true;
 		h->oldLoaded = deleteHistory;
 	}
+	Local::clearHistoryCache(peer->id);
 	if (peer->isChannel()) {
 		peer->asChannel()->ptsWaitingForShortPoll(-1);
 	}
@@ -850,6 +852,7 @@ void MainWidget::clearHistory(PeerData *peer) {
 		h->clear();
 		h->newLoaded = h->oldLoaded = true;
 	}
+	Local::clearHistoryCache(peer->id);
 	MTPmessages_DeleteHistory::Flags flags = MTPmessages_DeleteHistory::Flag::f_just_clear;
 	DeleteHistoryRequest request = { peer, true };
 	MTP::send(MTPmessages_DeleteHistory(MTP_flags(flags), peer->input, MTP_int(0)), rpcDone(&MainWidget::deleteHistoryPart, request));
@@ -2805,10 +2808,117 @@ void MainWidget::onUpdateNotifySettings() {
 
 void MainWidget::feedUpdateVector(const MTPVector<MTPUpdate> &updates, bool skipMessageIds) {
 	const auto &v(updates.c_vector().v);
+	startUpdatesBatch();
 	for (QVector<MTPUpdate>::const_iterator i = v.cbegin(), e = v.cend(); i != e; ++i) {
 		if (skipMessageIds && i->type() == mtpc_updateMessageID) continue;
 		feedUpdate(*i);
 	}
+	finishUpdatesBatch();
+}
+
+void MainWidget::startUpdatesBatch() {
+	++_updatesBatchLevel;
+}
+
+void MainWidget::finishUpdatesBatch() {
+	t_assert(_updatesBatchLevel > 0);
+	if (--_updatesBatchLevel > 0) return;
+
+	auto inboxRead = createAndSwap(_batchInboxRead);
+	auto outboxRead = createAndSwap(_batchOutboxRead);
+	auto viewsCount = createAndSwap(_batchViewsCount);
+	auto editedMessages = createAndSwap(_batchEditedMessages);
+	auto messagesUpdated = createAndSwap(_batchMessagesUpdated);
+
+	for (auto i = editedMessages.cbegin(), e = editedMessages.cend(); i != e; ++i) {
+		App::updateEditedMessage(i.value().c_message());
+	}
+	for (auto i = viewsCount.cbegin(), e = viewsCount.cend(); i != e; ++i) {
+		if (auto item = App::histItemById(i.key())) {
+			item->setViewsCount(i.value());
+		}
+	}
+	for (auto i = inboxRead.cbegin(), e = inboxRead.cend(); i != e; ++i) {
+		App::feedInboxRead(i.key(), i.value());
+	}
+
+	auto when = requestingDifference() ? 0 : unixtime();
+	bool updateHistory = false;
+	for (auto i = outboxRead.cbegin(), e = outboxRead.cend(); i != e; ++i) {
+		App::feedOutboxRead(i.key(), i.value(), when);
+		if (_history->peer() && _history->peer()->id == i.key()) {
+			updateHistory = true;
+		}
+	}
+	if (updateHistory) {
+		_history->update();
+	}
+
+	for_const (auto peerId, messagesUpdated) {
+		_history->peerMessagesUpdated(peerId);
+	}
+}
+
+bool MainWidget::batchInboxRead(PeerId peerId, MsgId upTo) {
+	if (!_updatesBatchLevel || upTo <= 0) return false;
+
+	auto i = _batchInboxRead.find(peerId);
+	if (i == _batchInboxRead.cend()) {
+		_batchInboxRead.insert(peerId, upTo);
+	} else {
+		accumulate_max(i.value(), upTo);
+	}
+	return true;
+}
+
+bool MainWidget::batchOutboxRead(PeerId peerId, MsgId upTo) {
+	if (!_updatesBatchLevel || upTo <= 0) return false;
+
+	auto i = _batchOutboxRead.find(peerId);
+	if (i == _batchOutboxRead.cend()) {
+		_batchOutboxRead.insert(peerId, upTo);
+	} else {
+		accumulate_max(i.value(), upTo);
+	}
+	return true;
+}
+
+bool MainWidget::batchViewsCount(const FullMsgId &msgId, int32 count) {
+	if (!_updatesBatchLevel) return false;
+
+	_batchViewsCount.insert(msgId, count);
+	return true;
+}
+
+bool MainWidget::batchEditedMessage(const MTPMessage &message) {
+	if (!_updatesBatchLevel || message.type() != mtpc_message) return false;
+
+	auto &m(message.c_message());
+	auto peerId = peerFromMTP(m.vto_id);
+	if (m.has_from_id() && peerToUser(peerId) == MTP::authedId()) {
+		peerId = peerFromUser(m.vfrom_id);
+	}
+	_batchEditedMessages.insert(FullMsgId(peerToChannel(peerId), m.vid.v), message); // the last edition wins
+	return true;
+}
+
+void MainWidget::applyBatchedInboxRead(PeerId peerId) {
+	// A new message must not be marked read or have its notification
+	// cleared by an inbox read that came before it in the same pack.
+	auto i = _batchInboxRead.find(peerId);
+	if (i != _batchInboxRead.cend()) {
+		auto upTo = i.value();
+		_batchInboxRead.erase(i);
+		App::feedInboxRead(peerId, upTo);
+	}
+}
+
+void MainWidget::batchPeerMessagesUpdated(PeerId peerId) {
+	if (_updatesBatchLevel) {
+		_batchMessagesUpdated.insert(peerId);
+	} else {
+		_history->peerMessagesUpdated(peerId);
+	}
 }
 
 void MainWidget::feedMessageIds(const MTPVector<MTPUpdate> &updates) {
@@ -3035,23 +3145,106 @@ void MainWidget::gotDifference(const MTPupdates_Difference &diff) {
 	} break;
 	case mtpc_updates_differenceSlice: {
 		const auto &d(diff.c_updates_differenceSlice());
-		feedDifference(d.vusers, d.vchats, d.vnew_messages, d.vother_updates);
+		applyDifference(d.vusers, d.vchats, d.vnew_messages, d.vother_updates, d.vintermediate_state, true);
+	} break;
+	case mtpc_updates_difference: {
+		const auto &d(diff.c_updates_difference());
+		applyDifference(d.vusers, d.vchats, d.vnew_messages, d.vother_updates, d.vstate, false);
+	} break;
+	};
+}
 
-		const auto &s(d.vintermediate_state.c_updates_state());
+void MainWidget::applyDifference(const MTPVector<MTPUser> &users, const MTPVector<MTPChat> &chats, const MTPVector<MTPMessage> &msgs, const MTPVector<MTPUpdate> &other, const MTPupdates_State &state, bool slice) {
+	const auto &vmsgs(msgs.c_vector().v);
+	const auto &vother(other.c_vector().v);
+	if (vmsgs.size() + vother.size() < DifferenceApplyInstantCount) {
+		feedDifference(users, chats, msgs, other);
+		differenceApplied(state, slice);
+		return;
+	}
+
+	App::wnd()->checkAutoLock();
+	App::feedUsers(users);
+	App::feedChats(chats);
+	feedMessageIds(other);
+
+	_differenceApplying = std_::make_unique<DifferenceApplying>();
+	_differenceApplying->state = state;
+	_differenceApplying->slice = slice;
+
+	QMap<uint64, int32> msgsIds;
+	for (int32 i = 0, l = vmsgs.size(); i < l; ++i) {
+		msgsIds.insert((uint64(uint32(idFromMessage(vmsgs.at(i)))) << 32) | uint64(i), i);
+	}
+	_differenceApplying->messages.reserve(msgsIds.size());
+	for (auto i = msgsIds.cbegin(), e = msgsIds.cend(); i != e; ++i) {
+		_differenceApplying->messages.push_back(vmsgs.at(i.value()));
+	}
+	_differenceApplying->updates.reserve(vother.size());
+	for_const (auto &update, vother) {
+		if (update.type() != mtpc_updateMessageID) {
+			_differenceApplying->updates.push_back(update);
+		}
+	}
+
+	LOG(("Applying difference of %1 messages and %2 updates in chunks").arg(_differenceApplying->messages.size()).arg(_differenceApplying->updates.size()));
+	onApplyDifferenceChunk();
+}
+
+void MainWidget::onApplyDifferenceChunk() {
+	if (!_differenceApplying) return;
+
+	auto &applying = *_differenceApplying;
+	auto ms = getms();
+	auto timeLeft = [ms] {
+		return (getms() - ms < DifferenceApplyChunkTime);
+	};
+
+	startUpdatesBatch();
+	while (applying.messagesApplied < applying.messages.size() && timeLeft()) {
+		auto count = qMin(int(DifferenceApplyChunkMessages), applying.messages.size() - applying.messagesApplied);
+		App::feedMsgs(applying.messages.mid(applying.messagesApplied, count), NewMessageUnread);
+		applying.messagesApplied += count;
+	}
+	if (applying.messagesApplied == applying.messages.size()) {
+		while (applying.updatesApplied < applying.updates.size() && timeLeft()) {
+			feedUpdate(applying.updates.at(applying.updatesApplied++));
+		}
+	}
+	finishUpdatesBatch();
+	_history->peerMessagesUpdated();
+
+	if (applying.messagesApplied < applying.messages.size() || applying.updatesApplied < applying.updates.size()) {
+		_differenceApplyTimer.start(0);
+		App::wnd()->updateTitleStatus();
+		return;
+	}
+
+	auto applied = std_::move(_differenceApplying);
+	App::wnd()->updateTitleStatus();
+	differenceApplied(applied->state, applied->slice);
+}
+
+int MainWidget::differenceAppliedCount() const {
+	return _differenceApplying ? (_differenceApplying->messagesApplied + _differenceApplying->updatesApplied) : 0;
+}
+
+int MainWidget::differenceFullCount() const {
+	return _differenceApplying ? (_differenceApplying->messages.size() + _differenceApplying->updates.size()) : 0;
+}
+
+void MainWidget::differenceApplied(const MTPupdates_State &state, bool slice) {
+	if (slice) {
+		const auto &s(state.c_updates_state());
 		updSetState(s.vpts.v, s.vdate.v, s.vqts.v, s.vseq.v);
 
 		_ptsWaiter.setRequesting(false);
 
 		MTP_LOG(0, ("getDifference { good - after a slice of difference was received }%1").arg(cTestMode() ? " TESTMODE" : ""));
 		getDifference();
-	} break;
-	case mtpc_updates_difference: {
-		const auto &d(diff.c_updates_difference());
-		feedDifference(d.vusers, d.vchats, d.vnew_messages, d.vother_updates);
-
-		gotState(d.vstate);
-	} break;
-	};
+	} else {
+		gotState(state);
+	}
 }
 
 bool MainWidget::getDifferenceTimeChanged(ChannelData *channel, int32 ms, ChannelGetDifferenceTime &channelCurTime, uint64 &curTime) {
@@ -3143,9 +3336,11 @@ void MainWidget::feedDifference(const MTPVector<MTPUser> &users, const MTPVector
 	App::wnd()->checkAutoLock();
 	App::feedUsers(users);
 	App::feedChats(chats);
+	startUpdatesBatch();
 	feedMessageIds(other);
 	App::feedMsgs(msgs, NewMessageUnread);
 	feedUpdateVector(other, true);
+	finishUpdatesBatch();
 	_history->peerMessagesUpdated();
 }
 
@@ -3265,6 +3460,7 @@ void MainWidget::start(const MTPUser &user) {
 	}
 
 	Local::readSavedPeers();
+	_dialogs->showDialogsCache();
 
 	cSetOtherOnline(0);
 	App::feedUsers(MTP_vector<MTPUser>(1, user));
@@ -3994,6 +4190,7 @@ DataIsLoadedResult allDataLoadedForMessage(const MTPMessage &msg) {
 } // namespace
 
 void MainWidget::feedUpdates(const MTPUpdates &updates, uint64 randomId) {
+	TRACE_SCOPE("MainWidget::feedUpdates");
 	switch (updates.type()) {
 	case mtpc_updates: {
 		const auto &d(updates.c_updates());
@@ -4147,9 +4344,10 @@ void MainWidget::feedUpdate(const MTPUpdate &update) {
 			}
 		}
 		if (needToAdd) {
+			applyBatchedInboxRead(peerFromMessage(d.vmessage));
 			HistoryItem *item = App::histories().addNewMessage(d.vmessage, NewMessageUnread);
 			if (item) {
-				_history->peerMessagesUpdated(item->history()->peer->id);
+				batchPeerMessagesUpdated(item->history()->peer->id);
 			}
 		}
 		ptsApplySkippedUpdates();
@@ -4219,7 +4417,10 @@ void MainWidget::feedUpdate(const MTPUpdate &update) {
 		}
 
 		// update before applying skipped
-		App::feedInboxRead(peerFromMTP(d.vpeer), d.vmax_id.v);
+		auto peerId = peerFromMTP(d.vpeer);
+		if (!batchInboxRead(peerId, d.vmax_id.v)) {
+			App::feedInboxRead(peerId, d.vmax_id.v);
+		}
 
 		ptsApplySkippedUpdates();
 	} break;
@@ -4233,10 +4434,12 @@ void MainWidget::feedUpdate(const MTPUpdate &update) {
 
 		// update before applying skipped
 		auto peerId = peerFromMTP(d.vpeer);
-		auto when = requestingDifference() ? 0 : unixtime();
-		App::feedOutboxRead(peerId, d.vmax_id.v, when);
-		if (_history->peer() && _history->peer()->id == peerId) {
-			_history->update();
+		if (!batchOutboxRead(peerId, d.vmax_id.v)) {
+			auto when = requestingDifference() ? 0 : unixtime();
+			App::feedOutboxRead(peerId, d.vmax_id.v, when);
+			if (_history->peer() && _history->peer()->id == peerId) {
+				_history->update();
+			}
 		}
 
 		ptsApplySkippedUpdates();
@@ -4523,9 +4726,10 @@ void MainWidget::feedUpdate(const MTPUpdate &update) {
 			}
 		}
 		if (needToAdd) {
+			applyBatchedInboxRead(peerFromMessage(d.vmessage));
 			HistoryItem *item = App::histories().addNewMessage(d.vmessage, NewMessageUnread);
 			if (item) {
-				_history->peerMessagesUpdated(item->history()->peer->id);
+				batchPeerMessagesUpdated(item->history()->peer->id);
 			}
 		}
 		if (channel && !_handlingChannelDifference) {
@@ -4546,7 +4750,7 @@ void MainWidget::feedUpdate(const MTPUpdate &update) {
 		}
 
 		// update before applying skipped
-		if (d.vmessage.type() == mtpc_message) { // apply message edit
+		if (d.vmessage.type() == mtpc_message && !batchEditedMessage(d.vmessage)) { // apply message edit
 			App::updateEditedMessage(d.vmessage.c_message());
 		}
 		if (channel && !_handlingChannelDifference) {
@@ -4563,7 +4767,9 @@ void MainWidget::feedUpdate(const MTPUpdate &update) {
 
 		// update before applying skipped
 		if (d.vmessage.type() == mtpc_message) { // apply message edit
-			App::updateEditedMessage(d.vmessage.c_message());
+			if (!batchEditedMessage(d.vmessage)) {
+				App::updateEditedMessage(d.vmessage.c_message());
+			}
 		} else if (d.vmessage.type() == mtpc_messageService) {
 			auto &message = d.vmessage.c_messageService();
 			if (message.vaction.type() == mtpc_messageActionHistoryClear) {
@@ -4589,16 +4795,21 @@ void MainWidget::feedUpdate(const MTPUpdate &update) {
 	case mtpc_updateReadChannelInbox: {
 		auto &d(update.c_updateReadChannelInbox());
 		auto channel = App::channelLoaded(d.vchannel_id.v);
-		App::feedInboxRead(peerFromChannel(d.vchannel_id.v), d.vmax_id.v);
+		auto peerId = peerFromChannel(d.vchannel_id.v);
+		if (!batchInboxRead(peerId, d.vmax_id.v)) {
+			App::feedInboxRead(peerId, d.vmax_id.v);
+		}
 	} break;
 
 	case mtpc_updateReadChannelOutbox: {
 		auto &d(update.c_updateReadChannelOutbox());
 		auto peerId = peerFromChannel(d.vchannel_id.v);
-		auto when = requestingDifference() ? 0 : unixtime();
-		App::feedOutboxRead(peerId, d.vmax_id.v, when);
-		if (_history->peer() && _history->peer()->id == peerId) {
-			_history->update();
+		if (!batchOutboxRead(peerId, d.vmax_id.v)) {
+			auto when = requestingDifference() ? 0 : unixtime();
+			App::feedOutboxRead(peerId, d.vmax_id.v, when);
+			if (_history->peer() && _history->peer()->id == peerId) {
+				_history->update();
+			}
 		}
 	} break;
 
@@ -4634,8 +4845,10 @@ void MainWidget::feedUpdate(const MTPUpdate &update) {
 
 	case mtpc_updateChannelMessageViews: {
 		const auto &d(update.c_updateChannelMessageViews());
-		if (HistoryItem *item = App::histItemById(d.vchannel_id.v, d.vid.v)) {
-			item->setViewsCount(d.vviews.v);
+		if (!batchViewsCount(FullMsgId(d.vchannel_id.v, d.vid.v), d.vviews.v)) {
+			if (HistoryItem *item = App::histItemById(d.vchannel_id.v, d.vid.v)) {
+				item->setViewsCount(d.vviews.v);
+			}
 		}
 	} break;
 
@@ -377,6 +377,12 @@ public:
 	void ptsWaiterStartTimerFor(ChannelData *channel, int32 ms); // ms <= 0 - stop timer
 	void feedUpdates(const MTPUpdates &updates, uint64 randomId = 0);
 	void feedUpdate(const MTPUpdate &update);
+
+	bool applyingDifference() const {
+		return (_differenceApplying != nullptr);
+	}
+	int differenceAppliedCount() const;
+	int differenceFullCount() const;
 	void updateAfterDrag();
 
 	void ctrlEnterSubmitUpdated();
@@ -453,6 +459,7 @@ public slots:
 
 	void onParentResize(const QSize &newSize);
 	void getDifference();
+	void onApplyDifferenceChunk();
 	void onGetDifferenceTimeByPts();
 	void onGetDifferenceTimeAfterFail();
 	void mtpPing();
@@ -543,6 +550,8 @@ private:
 	void gotDifference(const MTPupdates_Difference &diff);
 	bool failDifference(const RPCError &e);
 	void feedDifference(const MTPVector<MTPUser> &users, const MTPVector<MTPChat> &chats, const MTPVector<MTPMessage> &msgs, const MTPVector<MTPUpdate> &other);
+	void applyDifference(const MTPVector<MTPUser> &users, const MTPVector<MTPChat> &chats, const MTPVector<MTPMessage> &msgs, const MTPVector<MTPUpdate> &other, const MTPupdates_State &state, bool slice);
+	void differenceApplied(const MTPupdates_State &state, bool slice);
 	void gotState(const MTPupdates_State &state);
 	void updSetState(int32 pts, int32 date, int32 qts, int32 seq);
 	void gotChannelDifference(ChannelData *channel, const MTPupdates_ChannelDifference &diff);
@@ -552,6 +561,17 @@ private:
 	void feedUpdateVector(const MTPVector<MTPUpdate> &updates, bool skipMessageIds = false);
 	void feedMessageIds(const MTPVector<MTPUpdate> &updates);
 
+	// While a pack of updates is applied the read, views and edit updates
+	// are collected per peer / message and applied once in finishUpdatesBatch().
+	void startUpdatesBatch();
+	void finishUpdatesBatch();
+	bool batchInboxRead(PeerId peerId, MsgId upTo);
+	bool batchOutboxRead(PeerId peerId, MsgId upTo);
+	bool batchViewsCount(const FullMsgId &msgId, int32 count);
+	bool batchEditedMessage(const MTPMessage &message);
+	void applyBatchedInboxRead(PeerId peerId);
+	void batchPeerMessagesUpdated(PeerId peerId);
+
 	struct DeleteHistoryRequest {
 		PeerData *peer;
 		bool justClearHistory;
@@ -661,6 +681,25 @@ private:
 	uint64 _lastUpdateTime = 0;
 	bool _handlingChannelDifference = false;
 
+	// Big difference is applied in time limited chunks while the difference
+	// is still considered requesting, so the interface stays responsive.
+	struct DifferenceApplying {
+		QVector<MTPMessage> messages; // sorted by id, like in App::feedMsgs()
+		QVector<MTPUpdate> updates;
+		int messagesApplied = 0;
+		int updatesApplied = 0;
+		MTPupdates_State state;
+		bool slice = false;
+	};
+	std_::unique_ptr<DifferenceApplying> _differenceApplying;
+	SingleTimer _differenceApplyTimer;
+
+	int _updatesBatchLevel = 0;
+	QMap<PeerId, MsgId> _batchInboxRead, _batchOutboxRead;
+	QMap<FullMsgId, int32> _batchViewsCount;
+	QMap<FullMsgId, MTPMessage> _batchEditedMessages;
+	OrderedSet<PeerId> _batchMessagesUpdated;
+
 	QPixmap _cachedBackground;
 	QRect _cachedFor, _willCacheFor;
 	int _cachedX = 0;
@@ -753,6 +753,8 @@ void MainWindow::updateTitleStatus() {
 	} else if (state < 0) {
 		showConnecting(lng_reconnecting(lt_count, ((-state) / 1000) + 1), lang(lng_reconnecting_try_now));
 		QTimer::singleShot((-state) % 1000, this, SLOT(updateTitleStatus()));
+	} else if (main && main->applyingDifference()) {
+		showConnecting(lng_updating(lt_ready, QString::number(main->differenceAppliedCount()), lt_total, QString::number(main->differenceFullCount())));
 	} else {
 		hideConnecting();
 	}
@@ -177,21 +177,7 @@ void MediaView::mediaOverviewUpdated(PeerData *peer, MediaOverviewType type) {
 
 	if (_history && (_history->peer == peer || (_migrated && _migrated->peer == peer)) && type == _overview && _msgid) {
 		_index = -1;
-		if (_msgmigrated) {
-			for (int i = 0, l = _migrated->overview[_overview].size(); i < l; ++i) {
-				if (_migrated->overview[_overview].at(i) == _msgid) {
-					_index = i;
-					break;
-				}
-			}
-		} else {
-			for (int i = 0, l = _history->overview[_overview].size(); i < l; ++i) {
-				if (_history->overview[_overview].at(i) == _msgid) {
-					_index = i;
-					break;
-				}
-			}
-		}
+		_index = (_msgmigrated ? _migrated : _history)->overview[_overview].indexOf(_msgid);
 		updateControls();
 		preloadData(0);
 	} else if (_user == peer && type == OverviewCount) {
@@ -2151,11 +2137,9 @@ void MediaView::updateImage() {
 
 void MediaView::findCurrent() {
 	if (_msgmigrated) {
-		for (int i = 0, l = _migrated->overview[_overview].size(); i < l; ++i) {
-			if (_migrated->overview[_overview].at(i) == _msgid) {
-				_index = i;
-				break;
-			}
+		auto index = _migrated->overview[_overview].indexOf(_msgid);
+		if (index >= 0) {
+			_index = index;
 		}
 		if (!_history->overviewCountLoaded(_overview)) {
 			loadBack();
@@ -2165,11 +2149,9 @@ void MediaView::findCurrent() {
 			}
 		}
 	} else {
-		for (int i = 0, l = _history->overview[_overview].size(); i < l; ++i) {
-			if (_history->overview[_overview].at(i) == _msgid) {
-				_index = i;
-				break;
-			}
+		auto index = _history->overview[_overview].indexOf(_msgid);
+		if (index >= 0) {
+			_index = index;
 		}
 		if (!_history->overviewLoaded(_overview)) {
 			if (!_history->overviewCountLoaded(_overview) || (_index < 2 && _history->overviewCount(_overview) > 0) || (_index < 1 && _migrated && !_migrated->overviewLoaded(_overview))) {
@@ -2214,8 +2196,8 @@ void MediaView::loadBack() {
 
 MediaView::LastChatPhoto MediaView::computeLastOverviewChatPhoto() {
 	LastChatPhoto emptyResult = { nullptr, nullptr };
-	auto lastPhotoInOverview = [&emptyResult](auto history, auto list) -> LastChatPhoto {
-		if (auto item = App::histItemById(history->channelId(), list.back())) {
+	auto lastPhotoInOverview = [&emptyResult](History *history, const History::MediaOverview &list) -> LastChatPhoto {
+		if (auto item = App::histItemById(history->channelId(), list.at(list.size() - 1))) {
 			if (auto media = item->getMedia()) {
 				if (media->type() == MediaTypePhoto && !item->toHistoryMessage()) {
 					return { item, static_cast<HistoryPhoto*>(media)->photo() };
@@ -1030,8 +1030,11 @@ enum class MTPDmessage_ClientFlag : int32 {
 	// message is generated on the client side and should be unread
 	f_clientside_unread = (1 << 22),
 
+	// message was created from the local dialogs cache and not received from the server since
+	f_from_local_cache = (1 << 21),
+
 	// update this when adding new client side flags
-	MIN_FIELD = (1 << 22),
+	MIN_FIELD = (1 << 21),
 };
 DEFINE_MTP_CLIENT_FLAGS(MTPDmessage)
 
@@ -275,12 +275,7 @@ void PlayerWidget::findCurrent() {
 
 	const History::MediaOverview *o = &(_msgmigrated ? _migrated : _history)->overview[OverviewMusicFiles];
 	if ((_msgmigrated ? _migrated : _history)->channelId() == _song.contextId.channel) {
-		for (int i = 0, l = o->size(); i < l; ++i) {
-			if (o->at(i) == _song.contextId.msg) {
-				_index = i;
-				break;
-			}
-		}
+		_index = o->indexOf(_song.contextId.msg);
 	}
 	preloadNext();
 }
@@ -329,12 +324,9 @@ void PlayerWidget::mediaOverviewUpdated(PeerData *peer, MediaOverviewType type)
 		_index = -1;
 		History *history = _msgmigrated ? _migrated : _history;
 		if (history->channelId() == _song.contextId.channel && _song.contextId.msg) {
-			for (int i = 0, l = history->overview[OverviewMusicFiles].size(); i < l; ++i) {
-				if (history->overview[OverviewMusicFiles].at(i) == _song.contextId.msg) {
-					_index = i;
-					preloadNext();
-					break;
-				}
+			_index = history->overview[OverviewMusicFiles].indexOf(_song.contextId.msg);
+			if (_index >= 0) {
+				preloadNext();
 			}
 		}
 		updateControls();
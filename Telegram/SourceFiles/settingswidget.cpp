@@ -800,6 +800,48 @@ void SettingsInner::resizeEvent(QResizeEvent *e) {
 	}
 }
 
+void SettingsInner::showDebugStats() {
+	QStringList lines;
+
+	auto textStats = TextMemoryStats();
+	for_const (auto history, App::histories().map) {
+		for_const (auto block, history->blocks) {
+			for_const (auto item, block->items) {
+				item->addTextMemoryStats(textStats);
+			}
+		}
+	}
+	if (textStats.texts > 0) {
+		auto bytesNow = textStats.blocksBytes + textStats.wordsBytes;
+		lines.push_back(qsl("Messages: %1, text blocks: %2").arg(textStats.texts).arg(textStats.blocks));
+		lines.push_back(qsl("Text bytes per message: %1, with heap blocks: %2").arg(bytesNow / textStats.texts).arg(textStats.heapLayoutBytes / textStats.texts));
+	} else {
+		lines.push_back(qsl("Messages: 0"));
+	}
+
+	auto composers = 0;
+	auto composersUsed = int64(0), composersAllocated = int64(0);
+	auto layouts = GetComposerMetadataStats();
+	for_const (auto &layout, layouts) {
+		composers += layout.alive;
+		composersUsed += layout.usedBytes;
+		composersAllocated += layout.allocatedBytes;
+	}
+	lines.push_back(qsl("Composers: %1, used: %2 KB, allocated: %3 KB").arg(composers).arg(composersUsed / 1024).arg(composersAllocated / 1024));
+
+	auto clips = clipReadersStats();
+	auto decodeTimeAverage = clips.playing ? (clips.decodeTimeSum / clips.playing) : 0;
+	lines.push_back(qsl("Clip readers: %1, playing: %2, decode time: %3 us average, %4 us max").arg(clips.readers).arg(clips.playing).arg(decodeTimeAverage).arg(clips.decodeTimeMax));
+
+	auto framesCache = clipFramesCacheStats();
+	lines.push_back(qsl("Clip frames cache: %1 KB, frames played from it: %2, decoded: %3").arg(framesCache.size / 1024).arg(framesCache.hits).arg(framesCache.misses));
+
+	for_const (auto &line, lines) {
+		LOG(("Debug Stats: %1").arg(line));
+	}
+	Ui::showLayer(new InformBox(lines.join('\n')));
+}
+
 void SettingsInner::keyPressEvent(QKeyEvent *e) {
 	if (e->key() == Qt::Key_Escape || e->key() == Qt::Key_Back) {
 		App::wnd()->showSettings();
@@ -833,6 +875,18 @@ void SettingsInner::keyPressEvent(QKeyEvent *e) {
 			}
 			Ui::showLayer(new InformBox(DebugLogging::FileLoader() ? qsl("Enabled file download logging") : qsl("Disabled file download logging")));
 			break;
+		} else if (str == qstr("debugtrace") && cDebug()) {
+			if (Logs::Trace::enabled()) {
+				auto path = Logs::Trace::stop();
+				Ui::showLayer(new InformBox(path.isEmpty() ? qsl("Could not write the frame time trace") : qsl("Frame time trace written to:\n\n") + QDir::toNativeSeparators(path)));
+			} else {
+				Logs::Trace::start();
+				Ui::showLayer(new InformBox(qsl("Started frame time tracing, type it again to stop and write the trace")));
+			}
+			break;
+		} else if (str == qstr("debugstats") && cDebug()) {
+			showDebugStats();
+			break;
 		} else if (str == qstr("crashplease")) {
 			t_assert(!"Crashed in Settings!");
 			break;
@@ -861,6 +915,8 @@ void SettingsInner::keyPressEvent(QKeyEvent *e) {
 			qsl("clearstickers").startsWith(str) ||
 			qsl("moderate").startsWith(str) ||
 			qsl("debugfiles").startsWith(str) ||
+			qsl("debugtrace").startsWith(str) ||
+			qsl("debugstats").startsWith(str) ||
 			qsl("workmode").startsWith(str) ||
 			qsl("crashplease").startsWith(str)) {
 			break;
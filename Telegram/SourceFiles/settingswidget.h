@@ -203,6 +203,8 @@ private:
 
 	void setScale(DBIScale newScale);
 
+	void showDebugStats();
+
 	QString _testlang, _secretText;
 
 	UserData *_self;
@@ -36,6 +36,29 @@ namespace {
 	AnimationManager *_manager = 0;
 	QVector<QThread*> _clipThreads;
 	QVector<ClipReadManager*> _clipManagers;
+
+	// Readers can be moved from a busy clip thread to a less busy one, so all the
+	// access to a reader manager by its thread index is done with this mutex locked.
+	QMutex _clipManagersMutex;
+	bool _clipManagersStopping = false;
+
+	// Summed over all the clip threads, frame delays are stretched when the
+	// playing readers need more decoding time or repaints than we allow.
+	QAtomicInt _clipBusyLevelTotal;
+	QAtomicInt _clipActiveReadersTotal;
+
+	// Decoded frames of the small looping clips, summed over all the readers.
+	QAtomicInt _clipFramesCacheSize; // bytes
+	QAtomicInt _clipFramesCacheHits;
+	QAtomicInt _clipFramesCacheMisses;
+
+	// Percent of the natural frame delay the playing readers should use.
+	int32 clipFrameDelaySlowdown() {
+		static const int32 budget = qMax(QThread::idealThreadCount(), 1) * ClipDecodeBudgetPerCore;
+		int32 busy = _clipBusyLevelTotal.loadAcquire(), active = _clipActiveReadersTotal.loadAcquire();
+		int32 result = qMax(busy * 100 / budget, active * 100 / ClipActiveReadersLimit);
+		return snap(result, 100, ClipMaxFrameDelaySlowdown);
+	}
 };
 
 namespace anim {
@@ -92,11 +115,17 @@ namespace anim {
 
 		_manager = new AnimationManager();
 
+		QMutexLocker lock(&_clipManagersMutex);
+		_clipManagersStopping = false;
 	}
 
 	void stopManager() {
 		delete _manager;
 		_manager = 0;
+		{
+			QMutexLocker lock(&_clipManagersMutex);
+			_clipManagersStopping = true;
+		}
 		if (!_clipThreads.isEmpty()) {
 			for (int32 i = 0, l = _clipThreads.size(); i < l; ++i) {
 				_clipThreads.at(i)->quit();
@@ -108,6 +137,8 @@ namespace anim {
 			_clipThreads.clear();
 			_clipManagers.clear();
 		}
+		_clipBusyLevelTotal.storeRelease(0);
+		_clipActiveReadersTotal.storeRelease(0);
 	}
 
 }
@@ -164,6 +195,7 @@ void AnimationManager::stop(Animation *obj) {
 }
 
 void AnimationManager::timeout() {
+	TRACE_SCOPE("AnimationManager::timeout");
 	_iterating = true;
 	uint64 ms = getms();
 	for (AnimatingObjects::const_iterator i = _objects.begin(), e = _objects.end(); i != e; ++i) {
@@ -194,14 +226,38 @@ void AnimationManager::clipCallback(ClipReader *reader, qint32 threadIndex, qint
 	ClipReader::callback(reader, threadIndex, ClipReaderNotification(notification));
 }
 
-QPixmap _prepareFrame(const ClipFrameRequest &request, const QImage &original, bool hasAlpha, QImage &cache) {
+namespace {
+
+// Copies the frame to the pixels of the pixmap if nobody else holds it, so that
+// a playing clip reuses its frame pixmaps instead of allocating new ones each frame.
+// Opaque frames are prepared in Format_RGB32 and the others in an alpha format,
+// the pixmap keeps that without opaque detection, so the reused pixmap always
+// has the format of the frame and opaque frames keep the fast blit.
+void _frameToPixmap(QPixmap &to, const QImage &frame) {
+	bool reuse = !to.isNull() && to.isDetached()
+		&& (to.size() == frame.size())
+		&& (to.devicePixelRatio() == frame.devicePixelRatio())
+		&& (to.hasAlphaChannel() == frame.hasAlphaChannel());
+	if (reuse) {
+		QPainter p(&to);
+		p.setCompositionMode(QPainter::CompositionMode_Source);
+		p.drawImage(0, 0, frame);
+	} else {
+		to = QPixmap::fromImage(frame, Qt::ColorOnly | Qt::NoOpaqueDetection);
+	}
+}
+
+} // namespace
+
+void _prepareFrame(QPixmap &to, const ClipFrameRequest &request, const QImage &original, bool hasAlpha, QImage &cache) {
 	bool badSize = (original.width() != request.framew) || (original.height() != request.frameh);
 	bool needOuter = (request.outerw != request.framew) || (request.outerh != request.frameh);
 	if (badSize || needOuter || hasAlpha || request.rounded) {
 		int32 factor(request.factor);
-		bool newcache = (cache.width() != request.outerw || cache.height() != request.outerh);
+		auto format = (hasAlpha || request.rounded) ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+		bool newcache = (cache.width() != request.outerw || cache.height() != request.outerh || cache.format() != format);
 		if (newcache) {
-			cache = QImage(request.outerw, request.outerh, QImage::Format_ARGB32_Premultiplied);
+			cache = QImage(request.outerw, request.outerh, format);
 			cache.setDevicePixelRatio(factor);
 		}
 		{
@@ -232,9 +288,16 @@ QPixmap _prepareFrame(const ClipFrameRequest &request, const QImage &original, b
 		if (request.rounded) {
 			imageRound(cache, ImageRoundRadius::Large);
 		}
-		return QPixmap::fromImage(cache, Qt::ColorOnly);
+		_frameToPixmap(to, cache);
+	} else {
+		_frameToPixmap(to, original);
 	}
-	return QPixmap::fromImage(original, Qt::ColorOnly);
+}
+
+QPixmap _prepareFrame(const ClipFrameRequest &request, const QImage &original, bool hasAlpha, QImage &cache) {
+	QPixmap result;
+	_prepareFrame(result, request, original, hasAlpha, cache);
+	return result;
 }
 
 ClipReader::ClipReader(const FileLocation &location, const QByteArray &data, Callback &&callback)
@@ -246,6 +309,7 @@ ClipReader::ClipReader(const FileLocation &location, const QByteArray &data, Cal
 , _paused(0)
 , _autoplay(false)
 , _private(0) {
+	QMutexLocker lock(&_clipManagersMutex);
 	if (_clipThreads.size() < ClipThreadsCount) {
 		_threadIndex = _clipThreads.size();
 		_clipThreads.push_back(new QThread());
@@ -253,11 +317,12 @@ ClipReader::ClipReader(const FileLocation &location, const QByteArray &data, Cal
 		_clipThreads.back()->start();
 	} else {
 		_threadIndex = int32(rand_value<uint32>() % _clipThreads.size());
-		int32 loadLevel = 0x7FFFFFFF;
+		int32 busyLevel = 0x7FFFFFFF, loadLevel = 0x7FFFFFFF;
 		for (int32 i = 0, l = _clipThreads.size(); i < l; ++i) {
-			int32 level = _clipManagers.at(i)->loadLevel();
-			if (level < loadLevel) {
+			int32 busy = _clipManagers.at(i)->busyLevel(), level = _clipManagers.at(i)->loadLevel();
+			if (busy < busyLevel || (busy == busyLevel && level < loadLevel)) {
 				_threadIndex = i;
+				busyLevel = busy;
 				loadLevel = level;
 			}
 		}
@@ -332,8 +397,22 @@ void ClipReader::moveToNextWrite() const {
 }
 
 void ClipReader::callback(ClipReader *reader, int32 threadIndex, ClipReaderNotification notification) {
-	// check if reader is not deleted already
-	if (_clipManagers.size() > threadIndex && _clipManagers.at(threadIndex)->carries(reader)) {
+	// check if reader is not deleted already, it could be moved to another thread after the notification
+	bool carried = false;
+	{
+		QMutexLocker lock(&_clipManagersMutex);
+		if (_clipManagers.size() > threadIndex && _clipManagers.at(threadIndex)->carries(reader)) {
+			carried = true;
+		} else {
+			for_const (auto manager, _clipManagers) {
+				if (manager->carries(reader)) {
+					carried = true;
+					break;
+				}
+			}
+		}
+	}
+	if (carried) {
 		reader->_callback.call(notification);
 	}
 }
@@ -353,6 +432,8 @@ void ClipReader::start(int32 framew, int32 frameh, int32 outerw, int32 outerh, b
 		request.rounded = rounded;
 		_frames[0].request = _frames[1].request = _frames[2].request = request;
 		moveToNextShow();
+
+		QMutexLocker lock(&_clipManagersMutex);
 		_clipManagers.at(_threadIndex)->start(this);
 	}
 }
@@ -365,6 +446,8 @@ QPixmap ClipReader::current(int32 framew, int32 frameh, int32 outerw, int32 oute
 		frame->displayed.storeRelease(1);
 		if (_paused.loadAcquire()) {
 			_paused.storeRelease(0);
+
+			QMutexLocker lock(&_clipManagersMutex);
 			if (_clipManagers.size() <= _threadIndex) error();
 			if (_state != ClipError) {
 				_clipManagers.at(_threadIndex)->update(this);
@@ -395,9 +478,12 @@ QPixmap ClipReader::current(int32 framew, int32 frameh, int32 outerw, int32 oute
 
 	moveToNextShow();
 
-	if (_clipManagers.size() <= _threadIndex) error();
-	if (_state != ClipError) {
-		_clipManagers.at(_threadIndex)->update(this);
+	{
+		QMutexLocker lock(&_clipManagersMutex);
+		if (_clipManagers.size() <= _threadIndex) error();
+		if (_state != ClipError) {
+			_clipManagers.at(_threadIndex)->update(this);
+		}
 	}
 
 	return frame->pix;
@@ -428,6 +514,7 @@ ClipState ClipReader::state() const {
 }
 
 void ClipReader::stop() {
+	QMutexLocker lock(&_clipManagersMutex);
 	if (_clipManagers.size() <= _threadIndex) error();
 	if (_state != ClipError) {
 		_clipManagers.at(_threadIndex)->stop(this);
@@ -456,6 +543,10 @@ public:
 	virtual bool renderFrame(QImage &to, bool &hasAlpha, const QSize &size) = 0;
 	virtual int32 nextFrameDelay() = 0;
 	virtual bool start(bool onlyGifv) = 0;
+
+	// Used to continue playing a reader that was suspended while offscreen.
+	virtual int64 framePosition() const = 0; // ms of the last read frame
+	virtual bool seekToKeyframe(int64 ms) = 0; // the last keyframe before ms is read next
 	virtual ~ClipReaderImplementation() {
 	}
 	int64 dataSize() const {
@@ -491,13 +582,19 @@ public:
 	QtGifReaderImplementation(FileLocation *location, QByteArray *data) : ClipReaderImplementation(location, data)
 	, _reader(0)
 	, _framesLeft(0)
-	, _frameDelay(0) {
+	, _frameDelay(0)
+	, _frameMs(0)
+	, _hadFrame(false) {
 	}
 
 	bool readNextFrame() {
 		if (_reader) _frameDelay = _reader->nextImageDelay();
-		if (_framesLeft < 1 && !jumpToStart()) {
-			return false;
+		if (_framesLeft < 1) {
+			if (!jumpToStart()) {
+				return false;
+			}
+		} else if (_hadFrame) {
+			_frameMs += _frameDelay;
 		}
 
 		_frame = QImage(); // QGifHandler always reads first to internal QImage and returns it
@@ -505,6 +602,7 @@ public:
 			return false;
 		}
 		--_framesLeft;
+		_hadFrame = true;
 		return true;
 	}
 
@@ -541,6 +639,14 @@ public:
 		return jumpToStart();
 	}
 
+	int64 framePosition() const {
+		return _frameMs;
+	}
+
+	bool seekToKeyframe(int64 ms) { // every gif frame depends on the previous ones
+		return jumpToStart();
+	}
+
 	~QtGifReaderImplementation() {
 		deleteAndMark(_reader);
 	}
@@ -548,9 +654,13 @@ public:
 private:
 	QImageReader *_reader;
 	int32 _framesLeft, _frameDelay;
+	int64 _frameMs;
+	bool _hadFrame;
 	QImage _frame;
 
 	bool jumpToStart() {
+		_frameMs = 0;
+		_hadFrame = false;
 		if (_reader && _reader->jumpToImage(0)) {
 			_framesLeft = _reader->imageCount();
 			return true;
@@ -712,11 +822,15 @@ public:
 			}
 		}
 
+		// swscale writes right to the pixels of the image of the previous frame in this slot,
+		// the reader drops its reference to it before the slot is written again.
+		// Opaque frames are written as BGRA with 0xFF alpha, which is valid Format_RGB32.
+		hasAlpha = (_frame->format == AV_PIX_FMT_BGRA || (_frame->format == -1 && _codecContext->pix_fmt == AV_PIX_FMT_BGRA));
+		auto format = hasAlpha ? QImage::Format_ARGB32 : QImage::Format_RGB32;
 		QSize toSize(size.isEmpty() ? QSize(_width, _height) : size);
-		if (to.isNull() || to.size() != toSize) {
-			to = QImage(toSize, QImage::Format_ARGB32);
+		if (to.isNull() || to.size() != toSize || to.format() != format || !to.isDetached()) {
+			to = QImage(toSize, format);
 		}
-		hasAlpha = (_frame->format == AV_PIX_FMT_BGRA || (_frame->format == -1 && _codecContext->pix_fmt == AV_PIX_FMT_BGRA));
 		if (_frame->width == toSize.width() && _frame->height == toSize.height() && hasAlpha) {
 			int32 sbpl = _frame->linesize[0], dbpl = to.bytesPerLine(), bpl = qMin(sbpl, dbpl);
 			uchar *s = _frame->data[0], *d = to.bits();
@@ -808,6 +922,28 @@ public:
 		return true;
 	}
 
+	int64 framePosition() const {
+		return _frameMs;
+	}
+
+	bool seekToKeyframe(int64 ms) {
+		const AVRational &timeBase(_fmtContext->streams[_streamId]->time_base);
+		int64 ts = (ms * timeBase.den) / (1000LL * timeBase.num);
+
+		int res = 0;
+		if ((res = av_seek_frame(_fmtContext, _streamId, ts, AVSEEK_FLAG_BACKWARD)) < 0) {
+			char err[AV_ERROR_MAX_STRING_SIZE] = { 0 };
+			LOG(("Gif Error: Unable to av_seek_frame() to %1 %2, error %3, %4").arg(ms).arg(logData()).arg(res).arg(av_make_error_string(err, sizeof(err), res)));
+			return false;
+		}
+		avcodec_flush_buffers(_codecContext);
+
+		// The keyframe is not later than ms, so its frame delay will be the minimal one.
+		_frameMs = ms;
+		_nextFrameDelay = 0;
+		return true;
+	}
+
 	int32 duration() const {
 		if (_fmtContext->streams[_streamId]->duration == AV_NOPTS_VALUE) return 0;
 		return (_fmtContext->streams[_streamId]->duration * _fmtContext->streams[_streamId]->time_base.num) / _fmtContext->streams[_streamId]->time_base.den;
@@ -899,7 +1035,17 @@ public:
 	, _width(0)
 	, _height(0)
 	, _nextFrameWhen(0)
-	, _paused(false) {
+	, _frameDelay(0)
+	, _decodeTime(0)
+	, _paused(false)
+	, _pausedWhen(0)
+	, _suspended(false)
+	, _suspendedPosition(0)
+	, _framesCacheState(FramesCacheWaitingLoop)
+	, _framesCacheIndex(0)
+	, _framesCacheSize(0)
+	, _framesCacheLastPosition(0)
+	, _framesCachePending(false) {
 		if (_data.isEmpty() && !_location->accessEnable()) {
 			error();
 			return;
@@ -920,6 +1066,7 @@ public:
 			}
 			_width = frame()->original.width();
 			_height = frame()->original.height();
+			_framesCacheLastPosition = _implementation->framePosition();
 			return ClipProcessStarted;
 		}
 		return ClipProcessWait;
@@ -933,12 +1080,157 @@ public:
 		}
 
 		if (!_paused && ms >= _nextFrameWhen) {
+			if (_suspended && !resume(ms)) {
+				return error();
+			}
 			return ClipProcessRepaint;
 		}
 		return ClipProcessWait;
 	}
 
+	bool suspendable() const {
+		return !_suspended && (_implementation || _framesCacheState == FramesCacheFull);
+	}
+
+	// Paused for a long time, most likely scrolled out of view: release the decoder,
+	// the data read from the file and our frames, the last shown frame stays in the ClipReader.
+	void suspend() {
+		t_assert(_paused && suspendable());
+
+		_suspendedPosition = _implementation ? _implementation->framePosition() : 0;
+		releaseImplementation();
+		for (int32 i = 0; i < 3; ++i) {
+			_frames[i].pix = QPixmap();
+			_frames[i].original = QImage();
+			_frames[i].cache = QImage();
+		}
+		clearFramesCache();
+		_suspended = true;
+	}
+
+	bool resume(uint64 ms) {
+		t_assert(_suspended);
+
+		_suspended = false;
+		if (!init()) {
+			return false;
+		}
+		if (!_implementation->seekToKeyframe(_suspendedPosition) && !_implementation->seekToKeyframe(0)) {
+			return false;
+		}
+		_framesCacheLastPosition = 0;
+		_nextFrameWhen = ms;
+		return true;
+	}
+
+	void releaseImplementation() {
+		delete _implementation;
+		_implementation = 0;
+		if (_location) { // the data was read from the file in init()
+			_data = QByteArray();
+		}
+	}
+
+	// The decoder is released while the frames cache is full,
+	// when the cache is dropped the clip is played from the start again.
+	bool reopen() {
+		if (!init()) {
+			return false;
+		}
+		_framesCacheLastPosition = 0;
+		return true;
+	}
+
+	bool framesCacheFits() const {
+		return (_framesCacheRequest.factor == _request.factor && _framesCacheRequest.framew == _request.framew && _framesCacheRequest.frameh == _request.frameh);
+	}
+
+	// Prepared frames are cached only if they are the decoded ones as is,
+	// without rounding or letterboxing, so that they fit any such request.
+	bool framesCachePixFits() const {
+		return !_request.rounded && (_request.outerw == _request.framew) && (_request.outerh == _request.frameh);
+	}
+
+	// Called for each frame read by the implementation, frames are cached from
+	// the start of a loop and the cache is full when the next loop starts.
+	void framesCacheFrameRead() {
+		int64 position = _implementation->framePosition();
+		bool loopStarted = (position < _framesCacheLastPosition);
+		_framesCacheLastPosition = position;
+
+		if (_framesCacheState == FramesCacheFilling) {
+			if (_framesCachePending || _framesCache.isEmpty() || (loopStarted && !framesCacheFits())) {
+				clearFramesCache(); // a frame was skipped while catching up or the frame size was changed
+			} else if (loopStarted) {
+				_framesCacheState = FramesCacheFull;
+				_framesCacheIndex = 0;
+				DEBUG_LOG(("Gif Info: cached %1 frames, %2 bytes").arg(_framesCache.size()).arg(_framesCacheSize));
+
+				// All the following frames are played from the cache.
+				releaseImplementation();
+				return;
+			} else {
+				_framesCachePending = true;
+				return;
+			}
+		}
+		if (_framesCacheState == FramesCacheWaitingLoop && loopStarted) {
+			_framesCacheState = FramesCacheFilling;
+			_framesCacheRequest = _request;
+			_framesCachePending = true;
+		}
+	}
+
+	void framesCacheFrameRendered() {
+		if (_framesCacheState != FramesCacheFilling || !_framesCachePending) {
+			return;
+		}
+		if (!framesCacheFits()) {
+			clearFramesCache();
+			return;
+		}
+
+		auto pix = framesCachePixFits() ? frame()->pix : QPixmap();
+		int32 size = frame()->original.byteCount() + (pix.width() * pix.height() * pix.depth() / 8);
+		if (_framesCacheSize + size > ClipFramesCacheClipLimit) {
+			clearFramesCache();
+			_framesCacheState = FramesCacheDisabled; // too big to be cached
+			return;
+		}
+		if (_clipFramesCacheSize.fetchAndAddOrdered(size) + size > ClipFramesCacheLimit) {
+			_clipFramesCacheSize.fetchAndAddOrdered(-size);
+			clearFramesCache(); // will try again in the next loop
+			return;
+		}
+		_framesCacheSize += size;
+		_framesCache.push_back(CachedFrame(frame()->original, pix, frame()->alpha, _frameDelay));
+		_framesCachePending = false;
+	}
+
+	void clearFramesCache() {
+		_clipFramesCacheSize.fetchAndAddOrdered(-_framesCacheSize);
+		_framesCache.clear();
+		_framesCacheSize = 0;
+		_framesCacheIndex = 0;
+		_framesCachePending = false;
+		if (_framesCacheState != FramesCacheDisabled) {
+			_framesCacheState = FramesCacheWaitingLoop;
+		}
+	}
+
 	ClipProcessResult finishProcess(uint64 ms) {
+		TRACE_SCOPE("ClipReader::finishProcess");
+		QElapsedTimer timer;
+		timer.start();
+
+		auto result = decodeFrame(ms);
+
+		int32 elapsed = int32(timer.nsecsElapsed() / 1000);
+		_decodeTime = _decodeTime ? ((_decodeTime * 7 + elapsed) / 8) : elapsed;
+		return result;
+	}
+
+	ClipProcessResult decodeFrame(uint64 ms) {
 		if (!readNextFrame()) {
 			return error();
 		}
@@ -951,16 +1243,45 @@ public:
 		return ClipProcessCopyFrame;
 	}
 
-	uint64 nextFrameDelay() {
-		int32 delay = _implementation->nextFrameDelay();
-		return qMax(delay, 5);
+	uint64 nextFrameDelay(int32 delay) {
+		_frameDelay = qMax(delay, 5);
+		return (_frameDelay * clipFrameDelaySlowdown()) / 100;
+	}
+
+	// Permille of the time needed for decoding this reader frames at their natural rate.
+	int32 busyLevel() const {
+		if (!active() || !_frameDelay) {
+			return 0;
+		}
+		return _decodeTime / _frameDelay;
+	}
+
+	bool active() const {
+		return !_paused && _request.valid();
 	}
 
 	bool readNextFrame(bool keepup = false) {
-		if (!_implementation->readNextFrame()) {
-			return false;
+		if (_framesCacheState == FramesCacheFull && !framesCacheFits()) {
+			clearFramesCache();
+		}
+		if (_framesCacheState == FramesCacheFull) {
+			_framesCacheIndex = (_framesCacheIndex + 1) % _framesCache.size();
+			_clipFramesCacheHits.fetchAndAddRelaxed(1);
+		} else {
+			if (!_implementation && !reopen()) {
+				return false;
+			}
+			if (!_implementation->readNextFrame()) {
+				return false;
+			}
+			_clipFramesCacheMisses.fetchAndAddRelaxed(1);
+			framesCacheFrameRead();
+		}
+		if (_framesCacheState == FramesCacheFull) {
+			_nextFrameWhen += nextFrameDelay(_framesCache.at(_framesCacheIndex).delay);
+		} else {
+			_nextFrameWhen += nextFrameDelay(_implementation->nextFrameDelay());
 		}
-		_nextFrameWhen += nextFrameDelay();
 		if (keepup) {
 			_nextFrameWhen = qMax(_nextFrameWhen, getms());
 		}
@@ -969,12 +1290,23 @@ public:
 
 	bool renderFrame() {
 		t_assert(frame() != 0 && _request.valid());
-		if (!_implementation->renderFrame(frame()->original, frame()->alpha, QSize(_request.framew, _request.frameh))) {
-			return false;
+		if (_framesCacheState == FramesCacheFull) {
+			const CachedFrame &cached(_framesCache.at(_framesCacheIndex));
+			frame()->original = cached.original;
+			frame()->alpha = cached.alpha;
+			if (!cached.pix.isNull() && framesCachePixFits()) {
+				frame()->pix = cached.pix;
+			} else {
+				_prepareFrame(frame()->pix, _request, frame()->original, frame()->alpha, frame()->cache);
+			}
+		} else {
+			if (!_implementation->renderFrame(frame()->original, frame()->alpha, QSize(_request.framew, _request.frameh))) {
+				return false;
+			}
+			frame()->original.setDevicePixelRatio(_request.factor);
+			_prepareFrame(frame()->pix, _request, frame()->original, frame()->alpha, frame()->cache);
+			framesCacheFrameRendered();
 		}
-		frame()->original.setDevicePixelRatio(_request.factor);
-		frame()->pix = QPixmap();
-		frame()->pix = _prepareFrame(_request, frame()->original, frame()->alpha, frame()->cache);
 		frame()->when = _nextFrameWhen;
 		return true;
 	}
@@ -1004,6 +1336,7 @@ public:
 	void stop() {
 		delete _implementation;
 		_implementation = 0;
+		clearFramesCache();
 
 		if (_location) {
 			if (_accessed) {
@@ -1052,8 +1385,38 @@ private:
 	int32 _width, _height;
 
 	uint64 _nextFrameWhen;
+	int32 _frameDelay; // ms
+	int32 _decodeTime; // average for the last frames, microseconds
 
 	bool _paused;
+	uint64 _pausedWhen;
+
+	bool _suspended;
+	int64 _suspendedPosition; // ms
+
+	// Small looping clips keep all their decoded frames after a full loop
+	// and play the following loops without decoding.
+	enum FramesCacheState {
+		FramesCacheWaitingLoop, // frames are cached from the start of the next loop
+		FramesCacheFilling,
+		FramesCacheFull,
+		FramesCacheDisabled,
+	};
+	struct CachedFrame {
+		CachedFrame(const QImage &frame = QImage(), const QPixmap &prepared = QPixmap(), bool hasAlpha = true, int32 frameDelay = 0) : original(frame), pix(prepared), alpha(hasAlpha), delay(frameDelay) {
+		}
+		QImage original;
+		QPixmap pix; // null if the frame needed rounding or letterboxing
+		bool alpha;
+		int32 delay; // ms
+	};
+	QVector<CachedFrame> _framesCache;
+	FramesCacheState _framesCacheState;
+	ClipFrameRequest _framesCacheRequest;
+	int32 _framesCacheIndex; // the last read frame when full
+	int32 _framesCacheSize; // bytes
+	int64 _framesCacheLastPosition; // ms of the last frame read by the implementation
+	bool _framesCachePending; // the last read frame was not cached yet
 
 	friend class ClipReadManager;
 
@@ -1078,6 +1441,33 @@ void ClipReadManager::append(ClipReader *reader, const FileLocation &location, c
 	update(reader);
 }
 
+void ClipReadManager::adopt(ClipReader *reader, ClipReaderPrivate *readerPrivate) {
+	QWriteLocker lock(&_readerPointersMutex);
+	_readerPointers.insert(reader, MutableAtomicInt(1));
+	_adopted.push_back(readerPrivate);
+}
+
+void ClipReadManager::takeAdopted() {
+	QList<ClipReaderPrivate*> stopped; // while moving between the threads
+	{
+		QWriteLocker lock(&_readerPointersMutex);
+		for_const (auto reader, _adopted) {
+			if (_readers.contains(reader)) {
+				continue;
+			} else if (unsafeFindReaderPointer(reader) != _readerPointers.end()) {
+				_readers.insert(reader, 0);
+			} else {
+				stopped.push_back(reader);
+			}
+		}
+		_adopted.clear();
+	}
+	for_const (auto reader, stopped) {
+		_loadLevel.fetchAndAddRelaxed(-1 * (reader->_width > 0 ? reader->_width * reader->_height : AverageGifSize));
+		delete reader;
+	}
+}
+
 void ClipReadManager::start(ClipReader *reader) {
 	update(reader);
 }
@@ -1152,6 +1542,7 @@ bool ClipReadManager::handleProcessResult(ClipReaderPrivate *reader, ClipProcess
 		if (reader->_frames[ishowing].when > 0 && showing->displayed.loadAcquire() <= 0) { // current frame was not shown
 			if (reader->_frames[ishowing].when + WaitBeforeGifPause < ms || (reader->_frames[iprevious].when && previous->displayed.loadAcquire() <= 0)) {
 				reader->_paused = true;
+				reader->_pausedWhen = ms;
 				it.key()->_paused.storeRelease(1);
 				result = ClipProcessPaused;
 			}
@@ -1164,6 +1555,7 @@ bool ClipReadManager::handleProcessResult(ClipReaderPrivate *reader, ClipProcess
 		frame->pix = reader->frame()->pix;
 		frame->original = reader->frame()->original;
 		frame->displayed.storeRelease(0);
+		it.key()->_decodeTime.storeRelease(reader->_decodeTime);
 		if (result == ClipProcessStarted) {
 			reader->_nextFrameWhen = ms;
 			it.key()->moveToNextWrite();
@@ -1222,7 +1614,10 @@ void ClipReadManager::process() {
     _timer.stop();
 	_processingInThread = thread();
 
+	takeAdopted();
+
 	uint64 ms = getms(), minms = ms + 86400 * 1000ULL;
+	int32 busyLevel = 0, activeCount = 0;
 	{
 		QReadLocker lock(&_readerPointersMutex);
 		for (ReaderPointers::iterator it = _readerPointers.begin(), e = _readerPointers.end(); it != e; ++it) {
@@ -1257,13 +1652,28 @@ void ClipReadManager::process() {
 			ms = getms();
 			i.value() = reader->_nextFrameWhen ? reader->_nextFrameWhen : (ms + 86400 * 1000ULL);
 		}
-		if (!reader->_paused && i.value() < minms) {
+		if (reader->_paused) {
+			if (reader->suspendable()) {
+				uint64 suspendWhen = reader->_pausedWhen + ClipSuspendTimeout;
+				if (suspendWhen <= ms) {
+					reader->suspend();
+				} else if (suspendWhen < minms) {
+					minms = suspendWhen;
+				}
+			}
+		} else if (i.value() < minms) {
 			minms = i.value();
 		}
+		busyLevel += reader->busyLevel();
+		if (reader->active()) ++activeCount;
 		++i;
 	}
+	_clipBusyLevelTotal.fetchAndAddOrdered(busyLevel - _busyLevel.fetchAndStoreOrdered(busyLevel));
+	_clipActiveReadersTotal.fetchAndAddOrdered(activeCount - _activeCount);
+	_activeCount = activeCount;
 
 	ms = getms();
+	balanceLoad(ms);
 	if (_needReProcess || minms <= ms) {
 		_needReProcess = false;
 		_timer.start(1);
@@ -1274,6 +1684,69 @@ void ClipReadManager::process() {
 	_processingInThread = 0;
 }
 
+void ClipReadManager::balanceLoad(uint64 ms) {
+	int32 busyLevel = _busyLevel.loadAcquire();
+	if (busyLevel < ClipThreadBusyLevel || ms < _lastBalanceMs + ClipThreadBalanceTimeout) {
+		return;
+	}
+
+	QMutexLocker lock(&_clipManagersMutex);
+	if (_clipManagersStopping) {
+		return;
+	}
+
+	int32 idleIndex = -1, idleLevel = busyLevel;
+	for (int32 i = 0, l = _clipManagers.size(); i < l; ++i) {
+		ClipReadManager *manager = _clipManagers.at(i);
+		if (manager != this && manager->busyLevel() < idleLevel) {
+			idleIndex = i;
+			idleLevel = manager->busyLevel();
+		}
+	}
+	if (idleIndex < 0) {
+		return;
+	}
+
+	// Give away the reader that makes the two threads load as equal as possible.
+	ClipReaderPrivate *chosen = nullptr;
+	int32 chosenLevel = 0, bestDifference = busyLevel - idleLevel;
+	for (Readers::const_iterator i = _readers.cbegin(), e = _readers.cend(); i != e; ++i) {
+		int32 level = i.key()->busyLevel();
+		int32 difference = qAbs((busyLevel - level) - (idleLevel + level));
+		if (level > 0 && difference < bestDifference) {
+			chosen = i.key();
+			chosenLevel = level;
+			bestDifference = difference;
+		}
+	}
+	if (!chosen) {
+		return;
+	}
+
+	ClipReadManager *idle = _clipManagers.at(idleIndex);
+	{
+		QWriteLocker lock(&_readerPointersMutex);
+		ReaderPointers::iterator it = unsafeFindReaderPointer(chosen);
+		if (it == _readerPointers.end()) {
+			return; // stopped, will be removed in the next process()
+		}
+		ClipReader *clip = it.key();
+		_readerPointers.erase(it);
+		clip->_threadIndex = idleIndex;
+		idle->adopt(clip, chosen); // it will take the private part of the reader in its process()
+	}
+	_readers.remove(chosen);
+
+	int32 size = (chosen->_width > 0) ? (chosen->_width * chosen->_height) : AverageGifSize;
+	_loadLevel.fetchAndAddRelaxed(-size);
+	idle->_loadLevel.fetchAndAddRelaxed(size);
+	_busyLevel.fetchAndAddRelaxed(-chosenLevel);
+	idle->_busyLevel.fetchAndAddRelaxed(chosenLevel);
+	_lastBalanceMs = ms;
+
+	emit idle->processDelayed();
+}
+
 void ClipReadManager::finish() 	{
     _timer.stop();
     clear();
@@ -1286,6 +1759,13 @@ void ClipReadManager::clear() {
 			it.key()->_private = 0;
 		}
 		_readerPointers.clear();
+
+		for_const (auto reader, _adopted) {
+			if (!_readers.contains(reader)) {
+				delete reader;
+			}
+		}
+		_adopted.clear();
 	}
 
     for (Readers::iterator i = _readers.begin(), e = _readers.end(); i != e; ++i) {
@@ -1298,6 +1778,37 @@ ClipReadManager::~ClipReadManager() {
     clear();
 }
 
+void ClipReadManager::addStats(ClipReadersStats &stats) const {
+	QReadLocker lock(&_readerPointersMutex);
+	for (auto i = _readerPointers.cbegin(), e = _readerPointers.cend(); i != e; ++i) {
+		++stats.readers;
+		if (!i.key()->paused()) {
+			auto decodeTime = i.key()->decodeTime();
+			++stats.playing;
+			stats.decodeTimeSum += decodeTime;
+			accumulate_max(stats.decodeTimeMax, decodeTime);
+		}
+	}
+}
+
+ClipReadersStats clipReadersStats() {
+	ClipReadersStats result;
+
+	QMutexLocker lock(&_clipManagersMutex);
+	for_const (auto manager, _clipManagers) {
+		manager->addStats(result);
+	}
+	return result;
+}
+
+ClipFramesCacheStats clipFramesCacheStats() {
+	ClipFramesCacheStats result;
+	result.hits = _clipFramesCacheHits.loadAcquire();
+	result.misses = _clipFramesCacheMisses.loadAcquire();
+	result.size = _clipFramesCacheSize.loadAcquire();
+	return result;
+}
+
 MTPDocumentAttribute clipReadAnimatedAttributes(const QString &fname, const QByteArray &data, QImage &cover) {
 	FileLocation localloc(StorageFilePartial, fname);
 	QByteArray localdata(data);
@@ -555,9 +555,7 @@ public:
 	QPixmap frameOriginal() const {
 		Frame *frame = frameToShow();
 		if (!frame) return QPixmap();
-		QPixmap result(frame ? QPixmap::fromImage(frame->original) : QPixmap());
-		result.detach();
-		return result;
+		return QPixmap::fromImage(frame->original); // makes a copy of the pixels anyway
 	}
 	bool currentDisplayed() const {
 		Frame *frame = frameToShow();
@@ -569,6 +567,9 @@ public:
 	int32 threadIndex() const {
 		return _threadIndex;
 	}
+	int32 decodeTime() const { // average frame decode time in microseconds
+		return _decodeTime.loadAcquire();
+	}
 
 	int32 width() const;
 	int32 height() const;
@@ -614,7 +615,8 @@ private:
 	void moveToNextWrite() const;
 
 	QAtomicInt _paused;
-	int32 _threadIndex;
+	int32 _threadIndex; // changed only with both clip managers locked, readers can move between threads
+	QAtomicInt _decodeTime;
 
 	bool _autoplay;
 
@@ -635,6 +637,14 @@ enum ClipProcessResult {
 	ClipProcessWait,
 };
 
+struct ClipReadersStats {
+	int32 readers = 0;
+	int32 playing = 0;
+	int64 decodeTimeSum = 0; // microseconds, of the playing readers
+	int32 decodeTimeMax = 0;
+};
+ClipReadersStats clipReadersStats();
+
 class ClipReadManager : public QObject {
 	Q_OBJECT
 
@@ -644,11 +654,15 @@ public:
 	int32 loadLevel() const {
 		return _loadLevel.load();
 	}
+	int32 busyLevel() const { // permille of the time this thread needs for decoding frames
+		return _busyLevel.load();
+	}
 	void append(ClipReader *reader, const FileLocation &location, const QByteArray &data);
 	void start(ClipReader *reader);
 	void update(ClipReader *reader);
 	void stop(ClipReader *reader);
 	bool carries(ClipReader *reader) const;
+	void addStats(ClipReadersStats &stats) const;
 	~ClipReadManager();
 
 signals:
@@ -666,7 +680,14 @@ private:
 
     void clear();
 
+	void adopt(ClipReader *reader, ClipReaderPrivate *readerPrivate);
+	void takeAdopted();
+	void balanceLoad(uint64 ms);
+
 	QAtomicInt _loadLevel;
+	QAtomicInt _busyLevel;
+	int32 _activeCount = 0; // playing readers, counted in the last process()
+	uint64 _lastBalanceMs = 0;
 	struct MutableAtomicInt {
 		MutableAtomicInt(int value) : v(value) {
 		}
@@ -691,10 +712,20 @@ private:
 	typedef QMap<ClipReaderPrivate*, uint64> Readers;
 	Readers _readers;
 
+	// Given away by other threads and not yet taken, guarded by _readerPointersMutex.
+	// They are deleted if their readers were stopped before they were taken.
+	QList<ClipReaderPrivate*> _adopted;
+
 	QTimer _timer;
 	QThread *_processingInThread;
 	bool _needReProcess;
 
 };
 
+struct ClipFramesCacheStats {
+	int32 hits, misses; // frames played from the looping clips cache and decoded by the readers
+	int32 size; // bytes held in the cache
+};
+ClipFramesCacheStats clipFramesCacheStats();
+
 MTPDocumentAttribute clipReadAnimatedAttributes(const QString &fname, const QByteArray &data, QImage &cover);
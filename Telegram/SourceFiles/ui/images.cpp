@@ -107,6 +107,7 @@ const QPixmap &Image::pix(int32 w, int32 h) const {
 	uint64 k = (uint64(w) << 32) | uint64(h);
 	Sizes::const_iterator i = _sizesCache.constFind(k);
 	if (i == _sizesCache.cend()) {
+		TRACE_SCOPE("Image::pix miss");
 		QPixmap p(pixNoCache(w, h, ImagePixSmooth));
         if (cRetina()) p.setDevicePixelRatio(cRetinaFactor());
 		i = _sizesCache.insert(k, p);
@@ -129,6 +130,7 @@ const QPixmap &Image::pixRounded(ImageRoundRadius radius, int32 w, int32 h) cons
 	uint64 k = RoundedCacheSkip | (uint64(w) << 32) | uint64(h);
 	Sizes::const_iterator i = _sizesCache.constFind(k);
 	if (i == _sizesCache.cend()) {
+		TRACE_SCOPE("Image::pix miss");
 		auto options = ImagePixSmooth | (radius == ImageRoundRadius::Large ? ImagePixRoundedLarge : ImagePixRoundedSmall);
 		QPixmap p(pixNoCache(w, h, options));
 		if (cRetina()) p.setDevicePixelRatio(cRetinaFactor());
@@ -152,6 +154,7 @@ const QPixmap &Image::pixCircled(int32 w, int32 h) const {
 	uint64 k = CircledCacheSkip | (uint64(w) << 32) | uint64(h);
 	Sizes::const_iterator i = _sizesCache.constFind(k);
 	if (i == _sizesCache.cend()) {
+		TRACE_SCOPE("Image::pix miss");
 		QPixmap p(pixNoCache(w, h, ImagePixSmooth | ImagePixCircled));
 		if (cRetina()) p.setDevicePixelRatio(cRetinaFactor());
 		i = _sizesCache.insert(k, p);
@@ -174,6 +177,7 @@ const QPixmap &Image::pixBlurred(int32 w, int32 h) const {
 	uint64 k = BlurredCacheSkip | (uint64(w) << 32) | uint64(h);
 	Sizes::const_iterator i = _sizesCache.constFind(k);
 	if (i == _sizesCache.cend()) {
+		TRACE_SCOPE("Image::pix miss");
 		QPixmap p(pixNoCache(w, h, ImagePixSmooth | ImagePixBlurred));
 		if (cRetina()) p.setDevicePixelRatio(cRetinaFactor());
 		i = _sizesCache.insert(k, p);
@@ -196,6 +200,7 @@ const QPixmap &Image::pixColored(const style::color &add, int32 w, int32 h) cons
 	uint64 k = ColoredCacheSkip | (uint64(w) << 32) | uint64(h);
 	Sizes::const_iterator i = _sizesCache.constFind(k);
 	if (i == _sizesCache.cend()) {
+		TRACE_SCOPE("Image::pix miss");
 		QPixmap p(pixColoredNoCache(add, w, h, true));
 		if (cRetina()) p.setDevicePixelRatio(cRetinaFactor());
 		i = _sizesCache.insert(k, p);
@@ -218,6 +223,7 @@ const QPixmap &Image::pixBlurredColored(const style::color &add, int32 w, int32
 	uint64 k = BlurredColoredCacheSkip | (uint64(w) << 32) | uint64(h);
 	Sizes::const_iterator i = _sizesCache.constFind(k);
 	if (i == _sizesCache.cend()) {
+		TRACE_SCOPE("Image::pix miss");
 		QPixmap p(pixBlurredColoredNoCache(add, w, h));
 		if (cRetina()) p.setDevicePixelRatio(cRetinaFactor());
 		i = _sizesCache.insert(k, p);
@@ -240,6 +246,7 @@ const QPixmap &Image::pixSingle(ImageRoundRadius radius, int32 w, int32 h, int32
 	uint64 k = 0LL;
 	Sizes::const_iterator i = _sizesCache.constFind(k);
 	if (i == _sizesCache.cend() || i->width() != (outerw * cIntRetinaFactor()) || i->height() != (outerh * cIntRetinaFactor())) {
+		TRACE_SCOPE("Image::pix miss");
 		if (i != _sizesCache.cend()) {
 			globalAcquiredSize -= int64(i->width()) * i->height() * 4;
 		}
@@ -266,6 +273,7 @@ const QPixmap &Image::pixBlurredSingle(ImageRoundRadius radius, int w, int h, in
 	uint64 k = BlurredCacheSkip | 0LL;
 	Sizes::const_iterator i = _sizesCache.constFind(k);
 	if (i == _sizesCache.cend() || i->width() != (outerw * cIntRetinaFactor()) || i->height() != (outerh * cIntRetinaFactor())) {
+		TRACE_SCOPE("Image::pix miss");
 		if (i != _sizesCache.cend()) {
 			globalAcquiredSize -= int64(i->width()) * i->height() * 4;
 		}
@@ -24,7 +24,6 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 #include <private/qharfbuzz_p.h>
 
 #include "core/click_handler_types.h"
-#include "ui/text/text_block.h"
 #include "lang.h"
 #include "pspecific.h"
 #include "boxes/confirmbox.h"
@@ -38,8 +37,16 @@ void initDefault() {
 	_textStyle = &st::defaultTextStyle;
 }
 
+inline int32 countBlockHeight(const ITextBlock *b, const style::font &font, int styleLineHeight) {
+	return (b->type() == TextBlockTSkip) ? static_cast<const SkipBlock*>(b)->height() : (styleLineHeight > font->height) ? styleLineHeight : font->height;
+}
+
 inline int32 countBlockHeight(const ITextBlock *b, const style::font &font) {
-	return (b->type() == TextBlockTSkip) ? static_cast<const SkipBlock*>(b)->height() : (_textStyle->lineHeight > font->height) ? _textStyle->lineHeight : font->height;
+	return countBlockHeight(b, font, _textStyle->lineHeight);
+}
+
+inline int currentLineHeight() {
+	return _textStyle ? _textStyle->lineHeight : st::defaultTextStyle.lineHeight;
 }
 
 } // namespace
@@ -216,13 +223,13 @@ public:
 			}
 			lastSkipped = false;
 			if (emoji) {
-				_t->_blocks.push_back(new EmojiBlock(_t->_font, _t->_text, blockStart, len, flags, color, lnkIndex, emoji));
+				_t->_blocks.push_back(TextBlockHolder::Emoji(_t->_font, _t->_text, blockStart, len, flags, color, lnkIndex, emoji));
 				emoji = 0;
 				lastSkipped = true;
 			} else if (newline) {
-				_t->_blocks.push_back(new NewlineBlock(_t->_font, _t->_text, blockStart, len));
+				_t->_blocks.push_back(TextBlockHolder::Newline(_t->_font, _t->_text, blockStart, len));
 			} else {
-				_t->_blocks.push_back(new TextBlock(_t->_font, _t->_text, _t->_minResizeWidth, blockStart, len, flags, color, lnkIndex));
+				_t->_blocks.push_back(TextBlockHolder::Plain(_t->_font, _t->_text, _t->_minResizeWidth, blockStart, len, flags, color, lnkIndex));
 			}
 			blockStart += len;
 			blockCreated();
@@ -232,7 +239,7 @@ public:
 	void createSkipBlock(int32 w, int32 h) {
 		createBlock();
 		_t->_text.push_back('_');
-		_t->_blocks.push_back(new SkipBlock(_t->_font, _t->_text, blockStart++, w, h, lnkIndex));
+		_t->_blocks.push_back(TextBlockHolder::Skip(_t->_font, _t->_text, blockStart++, w, h, lnkIndex));
 		blockCreated();
 	}
 
@@ -289,7 +296,7 @@ public:
 		} else if (type == EntityInTextPre) {
 			startFlags = TextBlockFPre;
 			createBlock();
-			if (!_t->_blocks.isEmpty() && _t->_blocks.back()->type() != TextBlockTNewline) {
+			if (!_t->_blocks.empty() && _t->_blocks.back()->type() != TextBlockTNewline) {
 				createNewlineBlock();
 			}
 		} else if (type == EntityInTextUrl
@@ -645,7 +652,7 @@ public:
 
 		_t->_links.resize(maxLnkIndex);
 		for (Text::TextBlocks::const_iterator i = _t->_blocks.cbegin(), e = _t->_blocks.cend(); i != e; ++i) {
-			ITextBlock *b = *i;
+			ITextBlock *b = i->get();
 			if (b->lnkIndex() > 0x8000) {
 				lnkIndex = maxLnkIndex + (b->lnkIndex() - 0x8000);
 				if (_t->_links.size() < lnkIndex) {
@@ -693,7 +700,7 @@ public:
 			}
 		}
 		_t->_links.squeeze();
-		_t->_blocks.squeeze();
+		_t->_blocks.shrink_to_fit();
 		_t->_text.squeeze();
 	}
 
@@ -931,7 +938,7 @@ public:
 	void draw(int32 left, int32 top, int32 w, style::align align, int32 yFrom, int32 yTo, TextSelection selection = { 0, 0 }, bool fullWidthSelection = true) {
 		if (_t->isEmpty()) return;
 
-		_blocksSize = _t->_blocks.size();
+		_blocksSize = int32(_t->_blocks.size());
 		if (!_textStyle) initDefault();
 
 		if (_p) {
@@ -948,8 +955,8 @@ public:
 		_wLeft = _w = w;
 		if (_elideLast) {
 			_yToElide = _yTo;
-			if (_elideRemoveFromEnd > 0 && !_t->_blocks.isEmpty()) {
-				int firstBlockHeight = countBlockHeight(_t->_blocks.front(), _t->_font);
+			if (_elideRemoveFromEnd > 0 && !_t->_blocks.empty()) {
+				int firstBlockHeight = countBlockHeight(_t->_blocks.front().get(), _t->_font);
 				if (_y + firstBlockHeight >= _yToElide) {
 					_wLeft -= _elideRemoveFromEnd;
 				}
@@ -984,7 +991,7 @@ public:
 		bool longWordLine = true;
 		Text::TextBlocks::const_iterator e = _t->_blocks.cend();
 		for (Text::TextBlocks::const_iterator i = _t->_blocks.cbegin(); i != e; ++i, ++blockIndex) {
-			ITextBlock *b = *i;
+			ITextBlock *b = i->get();
 			TextBlockType _btype = b->type();
 			int32 blockHeight = countBlockHeight(b, _t->_font);
 
@@ -1211,7 +1218,7 @@ public:
 			}
 		}
 
-		ITextBlock *_endBlock = (_endBlockIter == _end) ? nullptr : (*_endBlockIter);
+		ITextBlock *_endBlock = (_endBlockIter == _end) ? nullptr : _endBlockIter->get();
 		bool elidedLine = _elideLast && (_y + _lineHeight >= _yToElide);
 		if (elidedLine) {
 			// If we decided to draw the last line elided only because of the skip block
@@ -1226,8 +1233,8 @@ public:
 		}
 
 		int blockIndex = _lineStartBlock;
-		ITextBlock *currentBlock = _t->_blocks[blockIndex];
-		ITextBlock *nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex] : 0;
+		ITextBlock *currentBlock = _t->_blocks[blockIndex].get();
+		ITextBlock *nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex].get() : nullptr;
 
 		int32 delta = (currentBlock->from() < _lineStart ? qMin(_lineStart - currentBlock->from(), 2) : 0);
 		_localFrom = _lineStart - delta;
@@ -1328,7 +1335,7 @@ public:
 			QScriptItem &si(engine.layoutData->items[firstItem + i]);
 			while (nextBlock && nextBlock->from() <= _localFrom + si.position) {
 				currentBlock = nextBlock;
-				nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex] : 0;
+				nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex].get() : nullptr;
 			}
 			TextBlockType _type = currentBlock->type();
 			if (_type == TextBlockTSkip) {
@@ -1353,8 +1360,8 @@ public:
 		}
 
 		blockIndex = _lineStartBlock;
-		currentBlock = _t->_blocks[blockIndex];
-		nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex] : 0;
+		currentBlock = _t->_blocks[blockIndex].get();
+		nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex].get() : nullptr;
 
 		int32 textY = _y + _yDelta + _t->_font->ascent, emojiY = (_t->_font->height - st::emojiSize) / 2;
 
@@ -1367,13 +1374,13 @@ public:
 
 			while (blockIndex > _lineStartBlock + 1 && _t->_blocks[blockIndex - 1]->from() > _localFrom + si.position) {
 				nextBlock = currentBlock;
-				currentBlock = _t->_blocks[--blockIndex - 1];
+				currentBlock = _t->_blocks[--blockIndex - 1].get();
 				if (_p) _p->setPen(blockPen(currentBlock));
 				eSetFont(currentBlock);
 			}
 			while (nextBlock && nextBlock->from() <= _localFrom + si.position) {
 				currentBlock = nextBlock;
-				nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex] : 0;
+				nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex].get() : nullptr;
 				if (_p) _p->setPen(blockPen(currentBlock));
 				eSetFont(currentBlock);
 			}
@@ -1580,10 +1587,11 @@ public:
 		}
 
 		_elideSavedIndex = blockIndex;
-		_elideSavedBlock = _t->_blocks[blockIndex];
-		const_cast<Text*>(_t)->_blocks[blockIndex] = new TextBlock(_t->_font, _t->_text, QFIXED_MAX, elideStart, 0, _elideSavedBlock->flags(), _elideSavedBlock->color(), _elideSavedBlock->lnkIndex());
+		auto &block = const_cast<Text*>(_t)->_blocks[blockIndex];
+		_elideSavedBlock = std_::move(block);
+		block = TextBlockHolder::Plain(_t->_font, _t->_text, QFIXED_MAX, elideStart, 0, _elideSavedBlock->flags(), _elideSavedBlock->color(), _elideSavedBlock->lnkIndex());
 		_blocksSize = blockIndex + 1;
-		_endBlock = (blockIndex + 1 < _t->_blocks.size() ? _t->_blocks[blockIndex + 1] : 0);
+		_endBlock = (blockIndex + 1 < int32(_t->_blocks.size())) ? _t->_blocks[blockIndex + 1].get() : nullptr;
 	}
 
 	void setElideBidi(int32 elideStart, int32 elideLen) {
@@ -1607,8 +1615,8 @@ public:
 		eItemize();
 
 		int blockIndex = _lineStartBlock;
-		ITextBlock *currentBlock = _t->_blocks[blockIndex];
-		ITextBlock *nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex] : 0;
+		ITextBlock *currentBlock = _t->_blocks[blockIndex].get();
+		ITextBlock *nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex].get() : nullptr;
 
 		QScriptLine line;
 		line.from = lineStart;
@@ -1625,7 +1633,7 @@ public:
 			QScriptItem &si(engine.layoutData->items[firstItem + i]);
 			while (nextBlock && nextBlock->from() <= _localFrom + si.position) {
 				currentBlock = nextBlock;
-				nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex] : 0;
+				nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex].get() : nullptr;
 			}
 			TextBlockType _type = currentBlock->type();
 			if (si.analysis.flags == QScriptAnalysis::Object) {
@@ -1696,7 +1704,7 @@ public:
 		lineLength += _Elide.size();
 
 		if (!repeat) {
-			for (; blockIndex < _blocksSize && _t->_blocks[blockIndex] != _endBlock && _t->_blocks[blockIndex]->from() < elideStart; ++blockIndex) {
+			for (; blockIndex < _blocksSize && _t->_blocks[blockIndex].get() != _endBlock && _t->_blocks[blockIndex]->from() < elideStart; ++blockIndex) {
 			}
 			if (blockIndex < _blocksSize) {
 				elideSaveBlock(blockIndex, _endBlock, elideStart, elideWidth);
@@ -1706,9 +1714,7 @@ public:
 
 	void restoreAfterElided() {
 		if (_elideSavedBlock) {
-			delete _t->_blocks[_elideSavedIndex];
-			const_cast<Text*>(_t)->_blocks[_elideSavedIndex] = _elideSavedBlock;
-			_elideSavedBlock = nullptr;
+			const_cast<Text*>(_t)->_blocks[_elideSavedIndex] = std_::move(_elideSavedBlock);
 		}
 	}
 
@@ -1719,14 +1725,14 @@ public:
 			return;
 
 		int blockIndex = _lineStartBlock;
-		ITextBlock *currentBlock = _t->_blocks[blockIndex];
-		ITextBlock *nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex] : 0;
+		ITextBlock *currentBlock = _t->_blocks[blockIndex].get();
+		ITextBlock *nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex].get() : nullptr;
 		eSetFont(currentBlock);
 		for (item = _e->findItem(line.from); item <= end; ++item) {
 			QScriptItem &si = _e->layoutData->items[item];
 			while (nextBlock && nextBlock->from() <= _localFrom + si.position) {
 				currentBlock = nextBlock;
-				nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex] : 0;
+				nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex].get() : nullptr;
 				eSetFont(currentBlock);
 			}
 			_e->shape(item);
@@ -1797,8 +1803,8 @@ public:
 		const ushort *string = reinterpret_cast<const ushort*>(_e->layoutData->string.unicode());
 
 		int blockIndex = _lineStartBlock;
-		ITextBlock *currentBlock = _t->_blocks[blockIndex];
-		ITextBlock *nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex] : 0;
+		ITextBlock *currentBlock = _t->_blocks[blockIndex].get();
+		ITextBlock *nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex].get() : nullptr;
 
 		_e->layoutData->hasBidi = _parHasBidi;
 		QScriptAnalysis *analysis = _parAnalysis.data() + (_localFrom - _parStart);
@@ -1811,15 +1817,15 @@ public:
 		}
 
 		blockIndex = _lineStartBlock;
-		currentBlock = _t->_blocks[blockIndex];
-		nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex] : 0;
+		currentBlock = _t->_blocks[blockIndex].get();
+		nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex].get() : nullptr;
 
 		const ushort *start = string;
 		const ushort *end = start + length;
 		while (start < end) {
 			while (nextBlock && nextBlock->from() <= _localFrom + (start - string)) {
 				currentBlock = nextBlock;
-				nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex] : 0;
+				nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex].get() : nullptr;
 			}
 			TextBlockType _type = currentBlock->type();
 			if (_type == TextBlockTEmoji || _type == TextBlockTSkip) {
@@ -1839,8 +1845,8 @@ public:
 			QScriptItemArray *i_items = &_e->layoutData->items;
 
 			blockIndex = _lineStartBlock;
-			currentBlock = _t->_blocks[blockIndex];
-			nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex] : 0;
+			currentBlock = _t->_blocks[blockIndex].get();
+			nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex].get() : nullptr;
 			ITextBlock *startBlock = currentBlock;
 
 			if (!length)
@@ -1849,7 +1855,7 @@ public:
 			for (int i = start + 1; i < end; ++i) {
 				while (nextBlock && nextBlock->from() <= _localFrom + i) {
 					currentBlock = nextBlock;
-					nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex] : 0;
+					nextBlock = (++blockIndex < _blocksSize) ? _t->_blocks[blockIndex].get() : nullptr;
 				}
 				// According to the unicode spec we should be treating characters in the Common script
 				// (punctuation, spaces, etc) as being the same script as the surrounding text for the
@@ -2360,7 +2366,7 @@ private:
 	// elided hack support
 	int32 _blocksSize;
 	int32 _elideSavedIndex;
-	ITextBlock *_elideSavedBlock = nullptr;
+	TextBlockHolder _elideSavedBlock;
 
 	int32 _lineStart, _localFrom;
 	int32 _lineStartBlock;
@@ -2406,12 +2412,10 @@ Text::Text(const Text &other)
 , _minHeight(other._minHeight)
 , _text(other._text)
 , _font(other._font)
-, _blocks(other._blocks.size())
+, _blocks(other._blocks)
 , _links(other._links)
 , _startDir(other._startDir) {
-	for (int32 i = 0, l = _blocks.size(); i < l; ++i) {
-		_blocks[i] = other._blocks.at(i)->clone();
-	}
+	std::copy(other._layoutCache, other._layoutCache + LayoutCacheSize, _layoutCache);
 }
 
 Text::Text(Text &&other)
@@ -2420,9 +2424,10 @@ Text::Text(Text &&other)
 , _minHeight(other._minHeight)
 , _text(other._text)
 , _font(other._font)
-, _blocks(other._blocks)
+, _blocks(std_::move(other._blocks))
 , _links(other._links)
 , _startDir(other._startDir) {
+	std::copy(other._layoutCache, other._layoutCache + LayoutCacheSize, _layoutCache);
 	other.clearFields();
 }
 
@@ -2432,12 +2437,10 @@ Text &Text::operator=(const Text &other) {
 	_minHeight = other._minHeight;
 	_text = other._text;
 	_font = other._font;
-	_blocks = TextBlocks(other._blocks.size());
+	_blocks = other._blocks;
 	_links = other._links;
 	_startDir = other._startDir;
-	for (int32 i = 0, l = _blocks.size(); i < l; ++i) {
-		_blocks[i] = other._blocks.at(i)->clone();
-	}
+	std::copy(other._layoutCache, other._layoutCache + LayoutCacheSize, _layoutCache);
 	return *this;
 }
 
@@ -2447,9 +2450,10 @@ Text &Text::operator=(Text &&other) {
 	_minHeight = other._minHeight;
 	_text = other._text;
 	_font = other._font;
-	_blocks = other._blocks;
+	_blocks = std_::move(other._blocks);
 	_links = other._links;
 	_startDir = other._startDir;
+	std::copy(other._layoutCache, other._layoutCache + LayoutCacheSize, _layoutCache);
 	other.clearFields();
 	return *this;
 }
@@ -2472,7 +2476,7 @@ void Text::recountNaturalSize(bool initial, Qt::LayoutDirection optionsDir) {
 	int32 result = 0, lastNewlineStart = 0;
 	QFixed _width = 0, last_rBearing = 0, last_rPadding = 0;
 	for (TextBlocks::const_iterator i = _blocks.cbegin(), e = _blocks.cend(); i != e; ++i) {
-		ITextBlock *b = *i;
+		ITextBlock *b = i->get();
 		TextBlockType _btype = b->type();
 		int32 blockHeight = countBlockHeight(b, _font);
 		if (_btype == TextBlockTNewline) {
@@ -2524,7 +2528,7 @@ void Text::recountNaturalSize(bool initial, Qt::LayoutDirection optionsDir) {
 		}
 	}
 	if (_width > 0) {
-		if (!lineHeight) lineHeight = countBlockHeight(_blocks.back(), _font);
+		if (!lineHeight) lineHeight = countBlockHeight(_blocks.back().get(), _font);
 		_minHeight += lineHeight;
 		if (_maxWidth < _width) {
 			_maxWidth = _width;
@@ -2660,26 +2664,28 @@ bool Text::hasLinks() const {
 }
 
 bool Text::hasSkipBlock() const {
-	return _blocks.isEmpty() ? false : _blocks.back()->type() == TextBlockTSkip;
+	return _blocks.empty() ? false : _blocks.back()->type() == TextBlockTSkip;
 }
 
 void Text::setSkipBlock(int32 width, int32 height) {
-	if (!_blocks.isEmpty() && _blocks.back()->type() == TextBlockTSkip) {
-		SkipBlock *block = static_cast<SkipBlock*>(_blocks.back());
+	if (!_blocks.empty() && _blocks.back()->type() == TextBlockTSkip) {
+		SkipBlock *block = static_cast<SkipBlock*>(_blocks.back().get());
 		if (block->width() == width && block->height() == height) return;
 		_text.resize(block->from());
 		_blocks.pop_back();
 	}
 	_text.push_back('_');
-	_blocks.push_back(new SkipBlock(_font, _text, _text.size() - 1, width, height, 0));
+	_blocks.push_back(TextBlockHolder::Skip(_font, _text, _text.size() - 1, width, height, 0));
 	recountNaturalSize(false);
+	invalidateLayoutCache();
 }
 
 void Text::removeSkipBlock() {
-	if (!_blocks.isEmpty() && _blocks.back()->type() == TextBlockTSkip) {
+	if (!_blocks.empty() && _blocks.back()->type() == TextBlockTSkip) {
 		_text.resize(_blocks.back()->from());
 		_blocks.pop_back();
 		recountNaturalSize(false);
+		invalidateLayoutCache();
 	}
 }
 
@@ -2687,44 +2693,74 @@ int Text::countWidth(int width) const {
 	if (QFixed(width) >= _maxWidth) {
 		return _maxWidth.ceil().toInt();
 	}
+	return layoutForWidth(width, currentLineHeight()).maxLineWidth;
+}
 
+int Text::countHeight(int width) const {
+	if (QFixed(width) >= _maxWidth) {
+		return _minHeight;
+	}
+	return layoutForWidth(width, currentLineHeight()).height;
+}
+
+int Text::countHeight(int width, const style::textStyle &st) const {
+	if (QFixed(width) >= _maxWidth) {
+		return _minHeight;
+	}
+	return layoutForWidth(width, st.lineHeight).height;
+}
+
+const Text::LayoutCacheEntry &Text::layoutForWidth(int width, int lineHeight) const {
+	for (int i = 0; i < LayoutCacheSize; ++i) {
+		if (_layoutCache[i].width == width && _layoutCache[i].lineHeight == lineHeight) {
+			if (i > 0) {
+				std::rotate(_layoutCache, _layoutCache + i, _layoutCache + i + 1);
+			}
+			return _layoutCache[0];
+		}
+	}
+
+	LayoutCacheEntry entry;
+	entry.width = width;
+	entry.lineHeight = lineHeight;
 	QFixed maxLineWidth = 0;
-	enumerateLines(width, [&maxLineWidth](QFixed lineWidth, int lineHeight) {
+	enumerateLines(width, lineHeight, [&entry, &maxLineWidth](QFixed lineWidth, int lineHeight) {
 		if (lineWidth > maxLineWidth) {
 			maxLineWidth = lineWidth;
 		}
+		entry.height += lineHeight;
 	});
-	return maxLineWidth.ceil().toInt();
+	entry.maxLineWidth = maxLineWidth.ceil().toInt();
+
+	std::rotate(_layoutCache, _layoutCache + LayoutCacheSize - 1, _layoutCache + LayoutCacheSize);
+	_layoutCache[0] = entry;
+	return _layoutCache[0];
 }
 
-int Text::countHeight(int width) const {
-	if (QFixed(width) >= _maxWidth) {
-		return _minHeight;
+void Text::invalidateLayoutCache() {
+	for (auto &entry : _layoutCache) {
+		entry = LayoutCacheEntry();
 	}
-	int result = 0;
-	enumerateLines(width, [&result](QFixed lineWidth, int lineHeight) {
-		result += lineHeight;
-	});
-	return result;
 }
 
 void Text::countLineWidths(int width, QVector<int> *lineWidths) const {
-	enumerateLines(width, [lineWidths](QFixed lineWidth, int lineHeight) {
+	enumerateLines(width, currentLineHeight(), [lineWidths](QFixed lineWidth, int lineHeight) {
 		lineWidths->push_back(lineWidth.ceil().toInt());
 	});
 }
 
 template <typename Callback>
-void Text::enumerateLines(int w, Callback callback) const {
+void Text::enumerateLines(int w, int styleLineHeight, Callback callback) const {
 	QFixed width = w;
 	if (width < _minResizeWidth) width = _minResizeWidth;
 
 	int lineHeight = 0;
 	QFixed widthLeft = width, last_rBearing = 0, last_rPadding = 0;
 	bool longWordLine = true;
-	for_const (auto b, _blocks) {
+	for_const (auto &block, _blocks) {
+		auto b = block.get();
 		TextBlockType _btype = b->type();
-		int blockHeight = countBlockHeight(b, _font);
+		int blockHeight = countBlockHeight(b, _font, styleLineHeight);
 
 		if (_btype == TextBlockTNewline) {
 			if (!lineHeight) lineHeight = blockHeight;
@@ -2828,10 +2864,12 @@ void Text::enumerateLines(int w, Callback callback) const {
 
 void Text::replaceFont(style::font f) {
 	_font = f;
+	invalidateLayoutCache();
 }
 
 void Text::draw(QPainter &painter, int32 left, int32 top, int32 w, style::align align, int32 yFrom, int32 yTo, TextSelection selection, bool fullWidthSelection) const {
 //	painter.fillRect(QRect(left, top, w, countHeight(w)), QColor(0, 0, 0, 32)); // debug
+	TRACE_SCOPE("Text::draw");
 	TextPainter p(&painter, this);
 	p.draw(left, top, w, align, yFrom, yTo, selection, fullWidthSelection);
 }
@@ -3021,10 +3059,35 @@ QString Text::originalText(TextSelection selection, ExpandLinksMode mode) const
 	return result;
 }
 
-void Text::clear() {
-	for (TextBlocks::iterator i = _blocks.begin(), e = _blocks.end(); i != e; ++i) {
-		delete *i;
+void Text::addMemoryStats(TextMemoryStats &stats) const {
+	// Rough heap allocation cost: size with the allocator header, 16 aligned.
+	auto heapBlockSize = [](std::size_t size) {
+		return int64((size + 16 + 15) & ~std::size_t(15));
+	};
+
+	++stats.texts;
+	stats.blocks += int(_blocks.size());
+	stats.blocksBytes += int64(_blocks.capacity()) * sizeof(TextBlockHolder);
+	stats.heapLayoutBytes += int64(_blocks.size()) * sizeof(ITextBlock*);
+	for_const (auto &block, _blocks) {
+		switch (block->type()) {
+		case TextBlockTNewline: stats.heapLayoutBytes += heapBlockSize(sizeof(NewlineBlock)); break;
+		case TextBlockTEmoji: stats.heapLayoutBytes += heapBlockSize(sizeof(EmojiBlock)); break;
+		case TextBlockTSkip: stats.heapLayoutBytes += heapBlockSize(sizeof(SkipBlock)); break;
+		case TextBlockTText: {
+			stats.heapLayoutBytes += heapBlockSize(sizeof(TextBlock));
+			auto &words = static_cast<const TextBlock*>(block.get())->_words;
+			if (words.capacity() > 0) {
+				auto bytes = heapBlockSize(sizeof(QArrayData) + words.capacity() * sizeof(TextWord));
+				stats.wordsBytes += bytes;
+				stats.heapLayoutBytes += bytes;
+			}
+		} break;
+		}
 	}
+}
+
+void Text::clear() {
 	clearFields();
 	_text.clear();
 }
@@ -3034,6 +3097,7 @@ void Text::clearFields() {
 	_links.clear();
 	_maxWidth = _minHeight = 0;
 	_startDir = Qt::LayoutDirectionAuto;
+	invalidateLayoutCache();
 }
 
 void emojiDraw(QPainter &p, EmojiPtr e, int x, int y) {
@@ -25,6 +25,7 @@ Copyright (c) 2014-2016 John Preston, https://desktop.telegram.org
 #include "core/click_handler.h"
 #include "ui/text/text_entity.h"
 #include "ui/emoji_config.h"
+#include "ui/text/text_block.h"
 
 static const QChar TextCommand(0x0010);
 enum TextCommands {
@@ -79,10 +80,20 @@ inline bool operator!=(TextSelection a, TextSelection b) {
 
 static constexpr TextSelection AllTextSelection = { 0, 0xFFFF };
 
+// Memory taken by the blocks of some texts, shown by the debug stats.
+// heapLayoutBytes estimates what the same blocks took when each of them
+// was allocated on the heap and the text kept an array of pointers.
+struct TextMemoryStats {
+	int texts = 0;
+	int blocks = 0;
+	int64 blocksBytes = 0;
+	int64 wordsBytes = 0;
+	int64 heapLayoutBytes = 0;
+};
+
 typedef QPair<QString, QString> TextCustomTag; // open str and close str
 typedef QMap<QChar, TextCustomTag> TextCustomTagsMap;
 
-class ITextBlock;
 class Text {
 public:
 
@@ -95,6 +106,7 @@ public:
 
 	int countWidth(int width) const;
 	int countHeight(int width) const;
+	int countHeight(int width, const style::textStyle &st) const; // with st instead of the current text style
 	void countLineWidths(int width, QVector<int> *lineWidths) const;
 	void setText(style::font font, const QString &text, const TextParseOptions &options = _defaultOptions);
 	void setRichText(style::font font, const QString &text, TextParseOptions options = _defaultOptions, const TextCustomTagsMap &custom = TextCustomTagsMap());
@@ -205,6 +217,8 @@ public:
 		return true;
 	}
 
+	void addMemoryStats(TextMemoryStats &stats) const;
+
 	void clear();
 	~Text() {
 		clear();
@@ -220,10 +234,25 @@ private:
 	// callback(lineWidth, lineHeight) will be called for all lines with:
 	// QFixed lineWidth, int lineHeight
 	template <typename Callback>
-	void enumerateLines(int w, Callback callback) const;
+	void enumerateLines(int w, int styleLineHeight, Callback callback) const;
 
 	void recountNaturalSize(bool initial, Qt::LayoutDirection optionsDir = Qt::LayoutDirectionAuto);
 
+	// Line breaking results for the last few widths, most recently used first.
+	// countWidth() and countHeight() are called with the same width many times
+	// while the history is resized, so we don't enumerate lines for them again.
+	struct LayoutCacheEntry {
+		int width = -1;
+		int lineHeight = 0; // of the text style the lines were counted with
+		int height = 0;
+		int maxLineWidth = 0;
+	};
+	enum {
+		LayoutCacheSize = 3,
+	};
+	const LayoutCacheEntry &layoutForWidth(int width, int lineHeight) const;
+	void invalidateLayoutCache();
+
 	// clear() deletes all blocks and calls this method
 	// it is also called from move constructor / assignment operator
 	void clearFields();
@@ -234,7 +263,7 @@ private:
 	QString _text;
 	style::font _font;
 
-	typedef QVector<ITextBlock*> TextBlocks;
+	typedef std::vector<TextBlockHolder> TextBlocks;
 	TextBlocks _blocks;
 
 	typedef QVector<ClickHandlerPtr> TextLinks;
@@ -242,6 +271,8 @@ private:
 
 	Qt::LayoutDirection _startDir;
 
+	mutable LayoutCacheEntry _layoutCache[LayoutCacheSize];
+
 	friend class TextParser;
 	friend class TextPainter;
 
@@ -359,3 +359,86 @@ SkipBlock::SkipBlock(const style::font &font, const QString &str, uint16 from, i
 	_flags |= ((TextBlockTSkip & 0x0F) << 8);
 	_width = w;
 }
+
+TextBlockHolder::TextBlockHolder(const TextBlockHolder &other) {
+	copyFrom(other);
+}
+
+TextBlockHolder::TextBlockHolder(TextBlockHolder &&other) noexcept {
+	moveFrom(other);
+}
+
+TextBlockHolder &TextBlockHolder::operator=(const TextBlockHolder &other) {
+	if (&other != this) {
+		destroy();
+		copyFrom(other);
+	}
+	return *this;
+}
+
+TextBlockHolder &TextBlockHolder::operator=(TextBlockHolder &&other) noexcept {
+	if (&other != this) {
+		destroy();
+		moveFrom(other);
+	}
+	return *this;
+}
+
+TextBlockHolder::~TextBlockHolder() {
+	destroy();
+}
+
+TextBlockHolder TextBlockHolder::Newline(const style::font &font, const QString &str, uint16 from, uint16 length) {
+	TextBlockHolder result;
+	result._block = new (&result._data) NewlineBlock(font, str, from, length);
+	return result;
+}
+
+TextBlockHolder TextBlockHolder::Plain(const style::font &font, const QString &str, QFixed minResizeWidth, uint16 from, uint16 length, uchar flags, const style::color &color, uint16 lnkIndex) {
+	TextBlockHolder result;
+	result._block = new (&result._data) TextBlock(font, str, minResizeWidth, from, length, flags, color, lnkIndex);
+	return result;
+}
+
+TextBlockHolder TextBlockHolder::Emoji(const style::font &font, const QString &str, uint16 from, uint16 length, uchar flags, const style::color &color, uint16 lnkIndex, const EmojiData *emoji) {
+	TextBlockHolder result;
+	result._block = new (&result._data) EmojiBlock(font, str, from, length, flags, color, lnkIndex, emoji);
+	return result;
+}
+
+TextBlockHolder TextBlockHolder::Skip(const style::font &font, const QString &str, uint16 from, int32 w, int32 h, uint16 lnkIndex) {
+	TextBlockHolder result;
+	result._block = new (&result._data) SkipBlock(font, str, from, w, h, lnkIndex);
+	return result;
+}
+
+// Blocks are cheap to copy: the only heap data is the implicitly shared words vector.
+void TextBlockHolder::copyFrom(const TextBlockHolder &other) {
+	if (!other) return;
+
+	switch (other->type()) {
+	case TextBlockTNewline: _block = new (&_data) NewlineBlock(*static_cast<const NewlineBlock*>(other.get())); break;
+	case TextBlockTText: _block = new (&_data) TextBlock(*static_cast<const TextBlock*>(other.get())); break;
+	case TextBlockTEmoji: _block = new (&_data) EmojiBlock(*static_cast<const EmojiBlock*>(other.get())); break;
+	case TextBlockTSkip: _block = new (&_data) SkipBlock(*static_cast<const SkipBlock*>(other.get())); break;
+	}
+}
+
+void TextBlockHolder::moveFrom(TextBlockHolder &other) {
+	if (!other) return;
+
+	switch (other->type()) {
+	case TextBlockTNewline: _block = new (&_data) NewlineBlock(std_::move(*static_cast<NewlineBlock*>(other.get()))); break;
+	case TextBlockTText: _block = new (&_data) TextBlock(std_::move(*static_cast<TextBlock*>(other.get()))); break;
+	case TextBlockTEmoji: _block = new (&_data) EmojiBlock(std_::move(*static_cast<EmojiBlock*>(other.get()))); break;
+	case TextBlockTSkip: _block = new (&_data) SkipBlock(std_::move(*static_cast<SkipBlock*>(other.get()))); break;
+	}
+	other.destroy();
+}
+
+void TextBlockHolder::destroy() {
+	if (_block) {
+		_block->~ITextBlock();
+		_block = nullptr;
+	}
+}
@@ -96,7 +96,6 @@ public:
 		return tmp;//_color;
 	}
 
-	virtual ITextBlock *clone() const = 0;
 	virtual ~ITextBlock() {
 	}
 
@@ -117,10 +116,6 @@ public:
 		return _nextDir;
 	}
 
-	ITextBlock *clone() const {
-		return new NewlineBlock(*this);
-	}
-
 private:
 
 	NewlineBlock(const style::font &font, const QString &str, uint16 from, uint16 length) : ITextBlock(font, str, from, length, 0, st::transparent, 0), _nextDir(Qt::LayoutDirectionAuto) {
@@ -131,6 +126,7 @@ private:
 
 	friend class Text;
 	friend class TextParser;
+	friend class TextBlockHolder;
 
 	friend class TextPainter;
 };
@@ -168,15 +164,11 @@ private:
 };
 
 class TextBlock : public ITextBlock {
-public:
-
-	ITextBlock *clone() const {
-		return new TextBlock(*this);
-	}
-
 private:
 
 	TextBlock(const style::font &font, const QString &str, QFixed minResizeWidth, uint16 from, uint16 length, uchar flags, const style::color &color, uint16 lnkIndex);
+	TextBlock(const TextBlock &other) = default;
+	TextBlock(TextBlock &&other) = default; // moves the words vector
 
 	friend class ITextBlock;
 	QFixed real_f_rbearing() const {
@@ -188,18 +180,13 @@ private:
 
 	friend class Text;
 	friend class TextParser;
+	friend class TextBlockHolder;
 
 	friend class BlockParser;
 	friend class TextPainter;
 };
 
 class EmojiBlock : public ITextBlock {
-public:
-
-	ITextBlock *clone() const {
-		return new EmojiBlock(*this);
-	}
-
 private:
 
 	EmojiBlock(const style::font &font, const QString &str, uint16 from, uint16 length, uchar flags, const style::color &color, uint16 lnkIndex, const EmojiData *emoji);
@@ -208,6 +195,7 @@ private:
 
 	friend class Text;
 	friend class TextParser;
+	friend class TextBlockHolder;
 
 	friend class TextPainter;
 };
@@ -219,10 +207,6 @@ public:
 		return _height;
 	}
 
-	ITextBlock *clone() const {
-		return new SkipBlock(*this);
-	}
-
 private:
 
 	SkipBlock(const style::font &font, const QString &str, uint16 from, int32 w, int32 h, uint16 lnkIndex);
@@ -231,6 +215,59 @@ private:
 
 	friend class Text;
 	friend class TextParser;
+	friend class TextBlockHolder;
 
 	friend class TextPainter;
 };
+
+namespace internal {
+
+constexpr std::size_t maxOf(std::size_t a, std::size_t b) {
+	return (a > b) ? a : b;
+}
+
+} // namespace internal
+
+// Owns one block of any type in place, so that Text can keep all of its
+// blocks in one contiguous array instead of allocating each of them on the
+// heap. Behaves like the owning ITextBlock* it replaces: get() and -> give
+// a mutable block even through a const holder, a default constructed or
+// moved from holder is empty.
+class TextBlockHolder {
+public:
+	TextBlockHolder() = default;
+	TextBlockHolder(const TextBlockHolder &other);
+	TextBlockHolder(TextBlockHolder &&other) noexcept;
+	TextBlockHolder &operator=(const TextBlockHolder &other);
+	TextBlockHolder &operator=(TextBlockHolder &&other) noexcept;
+	~TextBlockHolder();
+
+	static TextBlockHolder Newline(const style::font &font, const QString &str, uint16 from, uint16 length);
+	static TextBlockHolder Plain(const style::font &font, const QString &str, QFixed minResizeWidth, uint16 from, uint16 length, uchar flags, const style::color &color, uint16 lnkIndex);
+	static TextBlockHolder Emoji(const style::font &font, const QString &str, uint16 from, uint16 length, uchar flags, const style::color &color, uint16 lnkIndex, const EmojiData *emoji);
+	static TextBlockHolder Skip(const style::font &font, const QString &str, uint16 from, int32 w, int32 h, uint16 lnkIndex);
+
+	ITextBlock *get() const {
+		return _block;
+	}
+	explicit operator bool() const {
+		return (_block != nullptr);
+	}
+	ITextBlock *operator->() const {
+		return get();
+	}
+	ITextBlock &operator*() const {
+		return *get();
+	}
+
+private:
+	void copyFrom(const TextBlockHolder &other);
+	void moveFrom(TextBlockHolder &other);
+	void destroy();
+
+	static constexpr std::size_t DataSize = internal::maxOf(internal::maxOf(sizeof(NewlineBlock), sizeof(TextBlock)), internal::maxOf(sizeof(EmojiBlock), sizeof(SkipBlock)));
+	static constexpr std::size_t DataAlign = internal::maxOf(internal::maxOf(alignof(NewlineBlock), alignof(TextBlock)), internal::maxOf(alignof(EmojiBlock), alignof(SkipBlock)));
+	std::aligned_storage<DataSize, DataAlign>::type _data;
+	ITextBlock *_block = nullptr; // the block constructed in _data
+
+};
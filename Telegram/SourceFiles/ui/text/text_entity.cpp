@@ -1443,6 +1443,93 @@ MTPVector<MTPMessageEntity> linksToMTP(const EntitiesInText &links, bool sending
 }
 
 // Some code is duplicated in flattextarea.cpp!
+namespace {
+
+// Keeps the last match of a regular expression in the text and runs it again
+// only after the search offset has passed the start of that match.
+//
+// The first match found from some offset is also the first match found from
+// any later offset up to its start (and no match stays no match), because the
+// lookbehinds and the "^" assertions see the whole subject, not the offset.
+// So textParseEntities() scans the text by each expression about once instead
+// of once for every entity found by any of them.
+//
+// The expression is not run at all if the text lacks a character it needs.
+// Debug builds run it from every offset as before and check that the results are the same.
+class CachedMatch {
+public:
+	CachedMatch(const QRegularExpression &re, const QString &text, bool enabled = true, bool possible = true) : _re(re), _text(text), _enabled(enabled), _possible(possible) {
+	}
+
+	QRegularExpressionMatch match(int offset) {
+		if (!_enabled) {
+			return QRegularExpressionMatch();
+		}
+		if (!_possible) {
+			checkSame(QRegularExpressionMatch(), offset);
+			return QRegularExpressionMatch();
+		}
+		if (_from < 0 || offset < _from || (_match.hasMatch() && _match.capturedStart() < offset)) {
+			_match = _re.match(_text, offset);
+			_from = offset;
+		} else {
+			checkSame(_match, offset);
+		}
+		return _match;
+	}
+
+private:
+#ifdef _DEBUG
+	void checkSame(const QRegularExpressionMatch &result, int offset) const {
+		auto uncached = _re.match(_text, offset);
+		t_assert(uncached.hasMatch() == result.hasMatch());
+		if (uncached.hasMatch()) {
+			t_assert(uncached.capturedTexts() == result.capturedTexts());
+			for (int i = 0, l = uncached.lastCapturedIndex(); i <= l; ++i) {
+				t_assert(uncached.capturedStart(i) == result.capturedStart(i));
+			}
+		}
+	}
+#else // _DEBUG
+	void checkSame(const QRegularExpressionMatch &result, int offset) const {
+	}
+#endif // _DEBUG
+
+	const QRegularExpression &_re;
+	const QString &_text;
+	bool _enabled, _possible;
+	int _from = -1;
+	QRegularExpressionMatch _match;
+
+};
+
+// Characters that must be present in the text for the entity expressions to match.
+struct EntityTriggers {
+	bool backtick = false;
+	bool hash = false;
+	bool at = false;
+	bool slash = false;
+	bool dot = false;
+	bool colon = false;
+};
+
+EntityTriggers findEntityTriggers(const QString &text) {
+	EntityTriggers result;
+	for (const QChar *ch = text.constData(), *e = ch + text.size(); ch != e; ++ch) {
+		switch (ch->unicode()) {
+		case '`': result.backtick = true; break;
+		case '#': result.hash = true; break;
+		case '@': result.at = true; break;
+		case '/': result.slash = true; break;
+		case '.': result.dot = true; break;
+		case ':': result.colon = true; break;
+		}
+	}
+	return result;
+}
+
+} // namespace
+
 void textParseEntities(QString &text, int32 flags, EntitiesInText *inOutEntities, bool rich) {
 	EntitiesInText result;
 
@@ -1451,6 +1538,14 @@ void textParseEntities(QString &text, int32 flags, EntitiesInText *inOutEntities
 	bool withBotCommands = (flags & TextParseBotCommands);
 	bool withMono = (flags & TextParseMono);
 
+	auto triggers = findEntityTriggers(text);
+	if (withMono && !triggers.backtick) {
+#ifdef _DEBUG
+		t_assert(!_rePre.match(text).hasMatch() && !_reCode.match(text).hasMatch());
+#endif // _DEBUG
+		withMono = false;
+	}
+
 	if (withMono) { // parse mono entities (code and pre)
 		int existingEntityIndex = 0, existingEntitiesCount = inOutEntities->size();
 		int existingEntityShiftLeft = 0;
@@ -1460,6 +1555,7 @@ void textParseEntities(QString &text, int32 flags, EntitiesInText *inOutEntities
 		int32 offset = 0, matchOffset = offset, len = text.size(), commandOffset = rich ? 0 : len;
 		bool inLink = false, commandIsLink = false;
 		const QChar *start = text.constData();
+		CachedMatch rePre(_rePre, text), reCode(_reCode, text);
 		for (; matchOffset < len;) {
 			if (commandOffset <= matchOffset) {
 				for (commandOffset = matchOffset; commandOffset < len; ++commandOffset) {
@@ -1474,8 +1570,8 @@ void textParseEntities(QString &text, int32 flags, EntitiesInText *inOutEntities
 					commandIsLink = false;
 				}
 			}
-			auto mPre = _rePre.match(text, matchOffset);
-			auto mCode = _reCode.match(text, matchOffset);
+			auto mPre = rePre.match(matchOffset);
+			auto mCode = reCode.match(matchOffset);
 			if (!mPre.hasMatch() && !mCode.hasMatch()) break;
 
 			int preStart = mPre.hasMatch() ? mPre.capturedStart() : INT_MAX,
@@ -1610,6 +1706,14 @@ void textParseEntities(QString &text, int32 flags, EntitiesInText *inOutEntities
 	int32 len = text.size(), commandOffset = rich ? 0 : len;
 	bool inLink = false, commandIsLink = false;
 	const QChar *start = text.constData(), *end = start + text.size();
+	if (withMono) {
+		triggers = findEntityTriggers(text);
+	}
+	CachedMatch reDomain(_reDomain, text, true, triggers.dot);
+	CachedMatch reExplicitDomain(_reExplicitDomain, text, true, triggers.colon);
+	CachedMatch reHashtag(_reHashtag, text, withHashtags, triggers.hash);
+	CachedMatch reMention(_reMention, text, withMentions, triggers.at);
+	CachedMatch reBotCommand(_reBotCommand, text, withBotCommands, triggers.slash);
 	for (int32 offset = 0, matchOffset = offset, mentionSkip = 0; offset < len;) {
 		if (commandOffset <= offset) {
 			for (commandOffset = offset; commandOffset < len; ++commandOffset) {
@@ -1620,11 +1724,11 @@ void textParseEntities(QString &text, int32 flags, EntitiesInText *inOutEntities
 				}
 			}
 		}
-		auto mDomain = _reDomain.match(text, matchOffset);
-		auto mExplicitDomain = _reExplicitDomain.match(text, matchOffset);
-		auto mHashtag = withHashtags ? _reHashtag.match(text, matchOffset) : QRegularExpressionMatch();
-		auto mMention = withMentions ? _reMention.match(text, qMax(mentionSkip, matchOffset)) : QRegularExpressionMatch();
-		auto mBotCommand = withBotCommands ? _reBotCommand.match(text, matchOffset) : QRegularExpressionMatch();
+		auto mDomain = reDomain.match(matchOffset);
+		auto mExplicitDomain = reExplicitDomain.match(matchOffset);
+		auto mHashtag = reHashtag.match(matchOffset);
+		auto mMention = reMention.match(qMax(mentionSkip, matchOffset));
+		auto mBotCommand = reBotCommand.match(matchOffset);
 
 		EntityInTextType lnkType = EntityInTextUrl;
 		int32 lnkStart = 0, lnkLength = 0;
@@ -1655,7 +1759,7 @@ void textParseEntities(QString &text, int32 flags, EntitiesInText *inOutEntities
 			}
 			if (!(start + mentionStart + 1)->isLetter() || !(start + mentionEnd - 1)->isLetterOrNumber()) {
 				mentionSkip = mentionEnd;
-				mMention = _reMention.match(text, qMax(mentionSkip, matchOffset));
+				mMention = reMention.match(qMax(mentionSkip, matchOffset));
 				if (mMention.hasMatch()) {
 					mentionStart = mMention.capturedStart();
 					mentionEnd = mMention.capturedEnd();